@@ -22,30 +22,239 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L // posix_madvise
+#endif
+
 #include "soa.h"
 
 #include <memory.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <threads.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
-static soa_error_t s_error = {0};
+#if defined(_MSC_VER) && !defined(__clang__)
+#define SOA_THREAD_LOCAL __declspec(thread)
+#else
+#define SOA_THREAD_LOCAL _Thread_local
+#endif
+
+static SOA_THREAD_LOCAL soa_error_t s_error = {0};
 
 soa_error_t soa_error_get(){
     return s_error;
 }
 
-void soa_error_push(char* msg, int code){
-    if(s_error.msg){
-        free(s_error.msg);
-    }
-    s_error.code = code;
-    s_error.msg = strdup(msg);
+void soa_error_set(soa_error_t error){
+    s_error = error;
+}
+
+void soa_error_push(const char* msg, int code){
+    s_error = (soa_error_t){msg, code, 0};
 }
 
 void soa_error_pop(){
-    free(s_error.msg);
-    s_error.code = 0;
+    s_error = (soa_error_t){0};
+}
+
+void* _soa_alloc(const soa_allocator_t* alloc, size_t size){
+    return alloc ? alloc->alloc(alloc->user, size) : malloc(size);
+}
+
+void* _soa_realloc(const soa_allocator_t* alloc, void* ptr, size_t old_size, size_t size){
+    return alloc ? alloc->realloc(alloc->user, ptr, old_size, size) : realloc(ptr, size);
+}
+
+void _soa_free(const soa_allocator_t* alloc, void* ptr, size_t size){
+    if(alloc){
+        alloc->free(alloc->user, ptr, size);
+    }
+    else{
+        free(ptr);
+    }
+}
+
+// Thread pools
+//
+// Blocks are malloc'd with the size of their class, so any thread can
+// take back what another one handed out.
+
+#define _SOA_POOL_CLASSES 40
+
+typedef struct {
+    void* blocks[_SOA_POOL_CLASSES][SOA_POOL_SLOTS];
+    uint8_t count[_SOA_POOL_CLASSES];
+    size_t bytes;
+    int registered;
+} _soa_pool_t;
+
+static SOA_THREAD_LOCAL _soa_pool_t s_pool = {0};
+static once_flag s_pool_once = ONCE_FLAG_INIT;
+static tss_t s_pool_key;
+
+static void _pool_release(void* pool){
+    _soa_pool_t* p = pool;
+    for (int k = 0; k < _SOA_POOL_CLASSES; k++) {
+        for (int i = 0; i < p->count[k]; i++) {
+            free(p->blocks[k][i]);
+        }
+        p->count[k] = 0;
+    }
+    p->bytes = 0;
+}
+
+static void _pool_key_create(){
+    tss_create(&s_pool_key, _pool_release);
+}
+
+inline static int _pool_class(size_t size){
+    int k = 0;
+    while(k < _SOA_POOL_CLASSES - 1 && ((size_t)SOA_POOL_MIN << k) < size){
+        k++;
+    }
+    return k;
+}
+
+static void* _pool_alloc(void* user, size_t size){
+    (void)user;
+    int k = _pool_class(size);
+    if(s_pool.count[k]){
+        s_pool.bytes -= (size_t)SOA_POOL_MIN << k;
+        return s_pool.blocks[k][--s_pool.count[k]];
+    }
+    return malloc(size > ((size_t)SOA_POOL_MIN << k) ? size : (size_t)SOA_POOL_MIN << k);
+}
+
+static void _pool_free(void* user, void* ptr, size_t size){
+    (void)user;
+    int k = _pool_class(size);
+    size_t bytes = (size_t)SOA_POOL_MIN << k;
+    if(!ptr || s_pool.count[k] == SOA_POOL_SLOTS || s_pool.bytes + bytes > SOA_POOL_MAX_BYTES || bytes < size){
+        free(ptr);
+        return;
+    }
+    if(!s_pool.registered){
+        // frees the pool when the thread exits
+        call_once(&s_pool_once, _pool_key_create);
+        tss_set(s_pool_key, &s_pool);
+        s_pool.registered = 1;
+    }
+    s_pool.blocks[k][s_pool.count[k]++] = ptr;
+    s_pool.bytes += bytes;
+}
+
+static void* _pool_realloc(void* user, void* ptr, size_t old_size, size_t size){
+    (void)user;
+    if(!ptr){
+        return _pool_alloc(user, size);
+    }
+    int k = _pool_class(size);
+    int old_k = _pool_class(old_size);
+    size_t bytes = (size_t)SOA_POOL_MIN << k;
+    size_t old_bytes = (size_t)SOA_POOL_MIN << old_k;
+    // blocks hold their whole class, or the size asked when it is bigger
+    if(k == old_k && size <= (old_size > old_bytes ? old_size : old_bytes)){
+        return ptr;
+    }
+    if(size > bytes && old_size > old_bytes){
+        // too big for the pool either way
+        return realloc(ptr, size);
+    }
+    void* block = _pool_alloc(user, size);
+    if(block){
+        memcpy(block, ptr, old_size < size ? old_size : size);
+        _pool_free(user, ptr, old_size);
+    }
+    return block;
+}
+
+static const soa_allocator_t s_pool_allocator = {_pool_alloc, _pool_realloc, _pool_free, NULL};
+
+const soa_allocator_t* soa_pool_allocator(){
+    return &s_pool_allocator;
+}
+
+void soa_pool_trim(){
+    _pool_release(&s_pool);
+}
+
+_soa_map_t _soa_map_file(const char* path, int writable){
+    _soa_map_t map = {0};
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if(file == INVALID_HANDLE_VALUE){
+        return map;
+    }
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(file, &size)){
+        CloseHandle(file);
+        return map;
+    }
+    if(!size.QuadPart){
+        CloseHandle(file);
+        map.data = "";
+        return map;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, writable ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if(!mapping){
+        return map;
+    }
+    map.data = MapViewOfFile(mapping, writable ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if(map.data){
+        map.size = (size_t)size.QuadPart;
+        WIN32_MEMORY_RANGE_ENTRY range = {(void*)map.data, map.size};
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+    }
+#else
+    int fd = open(path, O_RDONLY);
+    if(fd < 0){
+        return map;
+    }
+    struct stat st;
+    if(fstat(fd, &st) || !S_ISREG(st.st_mode)){
+        close(fd);
+        return map;
+    }
+    if(!st.st_size){
+        close(fd);
+        map.data = "";
+        return map;
+    }
+    void* data = mmap(NULL, (size_t)st.st_size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED){
+        return map;
+    }
+    // read ahead aggressively, pages are read once front to back
+    posix_madvise(data, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+    posix_madvise(data, (size_t)st.st_size, POSIX_MADV_WILLNEED);
+    map.data = data;
+    map.size = (size_t)st.st_size;
+#endif
+    return map;
+}
+
+void _soa_unmap_file(_soa_map_t* map){
+    if(map->size){
+#ifdef _WIN32
+        UnmapViewOfFile(map->data);
+#else
+        munmap((void*)map->data, map->size);
+#endif
+    }
+    *map = (_soa_map_t){0};
 }
 
 soa_doc_t soa_doc_new(){
@@ -59,15 +268,36 @@ soa_doc_t soa_doc_new(){
     return doc;
 }
 
+static void _doc_unmap(soa_doc_t* doc){
+    _soa_map_t map = {(const char*)doc->data - sizeof(soa_snapshot_header_t), doc->mapped};
+    _soa_unmap_file(&map);
+    doc->mapped = 0;
+}
+
 void soa_doc_free(soa_doc_t* doc){
-    free(doc->data);
+    if(doc->mapped){
+        _doc_unmap(doc);
+    }
+    else{
+        _soa_free(doc->alloc, doc->data, doc->cap);
+    }
     *doc = (soa_doc_t){0};
 }
 
 uint8_t* _soa_doc_grow(soa_doc_t* doc, size_t size){
     if(doc->size + size > doc->cap){
-        doc->cap = (doc->size + size) * SOA_DOC_GROW_FACTOR;
-        doc->data = realloc(doc->data, doc->cap);
+        size_t cap = (doc->size + size) * SOA_DOC_GROW_FACTOR;
+        if(doc->mapped){
+            // snapshots move to the heap the first time they grow
+            uint8_t* data = _soa_alloc(doc->alloc, cap);
+            memcpy(data, doc->data, doc->size);
+            _doc_unmap(doc);
+            doc->data = data;
+        }
+        else{
+            doc->data = _soa_realloc(doc->alloc, doc->data, doc->cap, cap);
+        }
+        doc->cap = cap;
     }
     uint8_t* ptr = doc->data + doc->size;
     doc->size += size;
@@ -75,14 +305,127 @@ uint8_t* _soa_doc_grow(soa_doc_t* doc, size_t size){
 }
 
 size_t soa_doc_add_str(soa_doc_t* doc, const char* str){
-    char* last = (char*)_soa_doc_grow(doc, strlen(str) + 1);
-    strcpy(last, str);
-    return (uint8_t*)last - doc->data;
+    return soa_doc_add_str_n(doc, str, strlen(str));
+}
+
+size_t soa_doc_add_str_n(soa_doc_t* doc, const char* str, size_t len){
+    uint8_t* last = _soa_doc_grow(doc, sizeof(size_t) + len + 1);
+    memcpy(last, &len, sizeof(size_t));
+    memcpy(last + sizeof(size_t), str, len);
+    last[sizeof(size_t) + len] = 0;
+    return last + sizeof(size_t) - doc->data;
+}
+
+inline static size_t _str_len(const char* str){
+    size_t len;
+    memcpy(&len, str - sizeof(size_t), sizeof(size_t));
+    return len & ~(_SOA_STR_CLEAN | _SOA_STR_ASCII);
+}
+
+// Zero filled, last byte holds 7 - length so it doubles as terminator
+inline static void _sso_set(char* sso, const char* str, size_t len){
+    memset(sso, 0, 8);
+    memcpy(sso, str, len);
+    sso[7] = (char)(7 - len);
+}
+
+// Top bits of a container's length. A container that outgrew its place
+// leaves the new offset behind, one with slack has room for
+// _slack_cap(length) entries and one in columns keeps values, type tags
+// and keys in separate vectors. A packed array is followed by a word
+// holding the one type of all its values, then the values at their own
+// width.
+#define _SOA_MOVED ((size_t)1 << (sizeof(size_t) * 8 - 1))
+#define _SOA_SLACK ((size_t)1 << (sizeof(size_t) * 8 - 2))
+#define _SOA_COLUMNS ((size_t)1 << (sizeof(size_t) * 8 - 3))
+#define _SOA_PACKED ((size_t)1 << (sizeof(size_t) * 8 - 4))
+#define _SOA_LENGTH (~(_SOA_MOVED | _SOA_SLACK | _SOA_COLUMNS | _SOA_PACKED))
+#define _SOA_SHAPE (_SOA_COLUMNS | _SOA_PACKED)
+
+// Bytes of an object entry after its value, the type tag in rows and
+// unused in columns
+#define _SOA_KEY_RECORD (sizeof(soa_obj_entry_t) - sizeof(soa_valu_t))
+
+inline static size_t _head_size(int obj){
+    return obj ? sizeof(soa_obj_header_t) : sizeof(size_t);
+}
+
+inline static size_t _entry_size(int obj){
+    return obj ? sizeof(soa_obj_entry_t) : sizeof(soa_arr_entry_t);
+}
+
+// Entries of a container in columns, tags are padded to a whole word
+inline static size_t _columns_size(size_t length, int obj){
+    size_t tags = (length + sizeof(size_t) - 1) / sizeof(size_t) * sizeof(size_t);
+    return length * sizeof(soa_valu_t) + tags + (obj ? length * _SOA_KEY_RECORD : 0);
+}
+
+inline static size_t _packed_width(uint8_t type){
+    return type == SOA_TYPE_F32 ? sizeof(float) : sizeof(soa_valu_t);
+}
+
+// Where the values, type tags and key records of a container live, as
+// offsets into data and the step between entries
+typedef struct {
+    size_t values;
+    size_t tags;
+    size_t keys;
+    size_t vstride;
+    size_t tstride;
+    size_t kstride;
+    size_t vsize; // bytes of each value
+} _view_t;
+
+// word is the container's length word, packed the type of a packed array
+inline static _view_t _view_word(size_t word, uint8_t packed, size_t offset, int obj){
+    _view_t v = {.values = offset + _head_size(obj), .vsize = sizeof(soa_valu_t)};
+    if(word & _SOA_PACKED){
+        v.tags = v.values;
+        v.values += sizeof(size_t);
+        v.vstride = v.vsize = _packed_width(packed);
+    }
+    else if(word & _SOA_COLUMNS){
+        size_t length = word & _SOA_LENGTH;
+        v.tags = v.values + length * sizeof(soa_valu_t);
+        v.keys = v.tags + (length + sizeof(size_t) - 1) / sizeof(size_t) * sizeof(size_t);
+        v.vstride = sizeof(soa_valu_t);
+        v.tstride = 1;
+        v.kstride = _SOA_KEY_RECORD;
+    }
+    else{
+        v.tags = v.values + sizeof(soa_valu_t);
+        v.keys = v.tags;
+        v.vstride = v.tstride = v.kstride = _entry_size(obj);
+    }
+    return v;
+}
+
+inline static _view_t _view(const uint8_t* data, size_t offset, int obj){
+    size_t word;
+    memcpy(&word, data + offset, sizeof(size_t));
+    return _view_word(word, word & _SOA_PACKED ? data[offset + sizeof(size_t)] : 0, offset, obj);
+}
+
+inline static size_t _slack_cap(size_t length){
+    size_t cap = 4;
+    while(cap < length){
+        cap *= 2;
+    }
+    return cap;
+}
+
+inline static size_t _resolve(soa_doc_t* doc, size_t data){
+    size_t length;
+    while((length = *(size_t*)(doc->data + data)) & _SOA_MOVED){
+        data = length & ~_SOA_MOVED;
+    }
+    return data;
 }
 
 soa_obj_t soa_doc_add_obj(soa_doc_t* doc, size_t element_count){
-    uint8_t* last = _soa_doc_grow(doc, sizeof(size_t) + sizeof(soa_obj_entry_t) * element_count);
-    *(size_t*)last = element_count;
+    uint8_t* last = _soa_doc_grow(doc, sizeof(soa_obj_header_t) + sizeof(soa_obj_entry_t) * element_count);
+    *(soa_obj_header_t*)last = (soa_obj_header_t){.length = element_count};
+    memset(last + sizeof(soa_obj_header_t), 0, sizeof(soa_obj_entry_t) * element_count);
     
     return (soa_obj_t){.doc = doc, .data = last - doc->data};
 }
@@ -95,70 +438,493 @@ soa_arr_t soa_doc_add_arr(soa_doc_t* doc, size_t element_count){
 }
 
 soa_obj_t soa_doc_root_obj(soa_doc_t* doc){
-    return (soa_obj_t){.doc = doc, .data = doc->root};
+    return (soa_obj_t){.doc = doc, .data = doc->root_type ? _resolve(doc, doc->root) : doc->root};
 }
 
 soa_arr_t soa_doc_root_arr(soa_doc_t* doc){
-    return (soa_arr_t){.doc = doc, .data = doc->root};
+    return (soa_arr_t){.doc = doc, .data = doc->root_type ? _resolve(doc, doc->root) : doc->root};
+}
+
+uint32_t  soa_key_hash(const char* key, size_t len){
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ len;
+    while(len >= 8){
+        uint64_t w;
+        memcpy(&w, key, 8);
+        h = (h ^ w) * 0xFF51AFD7ED558CCDull;
+        h ^= h >> 32;
+        key += 8;
+        len -= 8;
+    }
+    if(len){
+        uint64_t w = 0;
+        memcpy(&w, key, len);
+        h = (h ^ w) * 0xC4CEB9FE1A85EC53ull;
+    }
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 32;
+    return (uint32_t)h ? (uint32_t)h : 1;
+}
+
+inline static soa_obj_header_t* _obj_header(soa_obj_t* obj){
+    return (soa_obj_header_t*)(obj->doc->data + obj->data);
+}
+
+// Only the key fields are valid in columns, values go through soa_val_t
+inline static soa_obj_entry_t* _obj_entry(soa_obj_t* obj, size_t index){
+    if(!(_obj_header(obj)->length & _SOA_COLUMNS)){
+        return (soa_obj_entry_t*)(obj->doc->data + obj->data + sizeof(soa_obj_header_t)) + index;
+    }
+    _view_t v = _view(obj->doc->data, obj->data, 1);
+    return (soa_obj_entry_t*)(obj->doc->data + v.keys + index * v.kstride - sizeof(soa_valu_t));
+}
+
+inline static const char* _obj_key(soa_obj_t* obj, soa_obj_entry_t* e, size_t* len){
+    switch(e->sso){
+        case SOA_KEY_SSO:
+            *len = 7 - e->key.sso[7];
+            return e->key.sso;
+        case SOA_KEY_REF:
+            *len = e->key.ref.length;
+            return obj->doc->source + e->key.ref.offset;
+        default:{
+            const char* k = (char*)(obj->doc->data + e->key.str);
+            *len = _str_len(k);
+            return k;
+        }
+    }
 }
 
 char*     soa_obj_key_at(soa_obj_t* obj, size_t index){
-    soa_obj_entry_t* e = (soa_obj_entry_t*)(obj->doc->data + obj->data + index * sizeof(soa_obj_entry_t) + sizeof(size_t));
+    soa_obj_entry_t* e = _obj_entry(obj, index);
+    if(e->sso == SOA_KEY_REF){
+        soa_ref_t ref = e->key.ref;
+        size_t str = soa_doc_add_str_n(obj->doc, obj->doc->source + ref.offset, ref.length);
+        e = _obj_entry(obj, index);
+        e->sso = SOA_KEY_STR;
+        e->key.str = str;
+    }
     return e->sso ? e->key.sso : (char*)(obj->doc->data + e->key.str);
 }
 
+const char* soa_obj_key_at_n(soa_obj_t* obj, size_t index, size_t* len){
+    return _obj_key(obj, _obj_entry(obj, index), len);
+}
+
 void      soa_obj_set_key_at(soa_obj_t* obj, size_t index,  const char* key){
-    soa_obj_entry_t* e = (soa_obj_entry_t*)(obj->doc->data + obj->data + index * sizeof(soa_obj_entry_t) + sizeof(size_t));
-    if(strlen(key) < 8) {
-        memcpy(e->key.sso, key, strlen(key) + 1);
-        e->sso = 1;
+    soa_obj_set_key_at_n(obj, index, key, strlen(key));
+}
+
+void      soa_obj_set_key_at_n(soa_obj_t* obj, size_t index, const char* key, size_t len){
+    // index may point at the old key
+    _obj_header(obj)->index = 0;
+    if(len < 8) {
+        soa_obj_entry_t* e = _obj_entry(obj, index);
+        _sso_set(e->key.sso, key, len);
+        e->sso = SOA_KEY_SSO;
+        e->hash = soa_key_hash(key, len);
     }
     else{
-        e->key.str = soa_doc_add_str(obj->doc, key);
-        e->sso = 0;
+        uint32_t hash = soa_key_hash(key, len);
+        size_t str = soa_doc_add_str_n(obj->doc, key, len);
+        soa_obj_entry_t* e = _obj_entry(obj, index);
+        e->key.str = str;
+        e->sso = SOA_KEY_STR;
+        e->hash = hash;
     }
 }
 
 size_t    soa_obj_length(soa_obj_t* obj){
-    return *(size_t*)(obj->doc->data + obj->data);
+    return _obj_header(obj)->length & _SOA_LENGTH;
 }
 
 soa_val_t soa_obj_val_at_index(soa_obj_t* obj, size_t index){
     if(index >= soa_obj_length(obj)) return (soa_val_t){0};
+    if(_obj_header(obj)->length & _SOA_COLUMNS){
+        _view_t v = _view(obj->doc->data, obj->data, 1);
+        return (soa_val_t){
+            .doc = obj->doc,
+            .data = v.values + index * v.vstride,
+            .tag = v.tags + index
+        };
+    }
     return (soa_val_t){
         .doc = obj->doc,
-        .data = obj->data + index * sizeof(soa_obj_entry_t) + sizeof(size_t),
+        .data = obj->data + index * sizeof(soa_obj_entry_t) + sizeof(soa_obj_header_t),
     };
 }
 
-soa_val_t soa_obj_val_at_key(soa_obj_t* obj, const char* key){
-    for (size_t i = 0; i < soa_obj_length(obj); i++) {
-        soa_val_t val = soa_obj_val_at_index(obj, i);
-        soa_obj_entry_t* entry = (soa_obj_entry_t*)obj->doc->data + val.data;
-        if(
-            entry->sso && strcmp(entry->key.sso, key) == 0 ||
-            !entry->sso && strcmp((char*)(obj->doc->data + entry->key.str), key) == 0
-        ){
-            return val;
+inline static int _obj_key_eq(soa_obj_t* obj, soa_obj_entry_t* e, const char* key, size_t len, uint32_t hash){
+    if(e->hash && e->hash != hash) return 0;
+    size_t k_len;
+    const char* k = _obj_key(obj, e, &k_len);
+    return k_len == len && memcmp(k, key, len) == 0;
+}
+
+void      soa_obj_build_index(soa_obj_t* obj){
+    size_t length = soa_obj_length(obj);
+    size_t cap = 8;
+    while(cap < length * 2){
+        cap *= 2;
+    }
+
+    // table is appended, header and entries have to be found again after
+    size_t pad = (sizeof(size_t) - obj->doc->size % sizeof(size_t)) % sizeof(size_t);
+    uint8_t* table = _soa_doc_grow(obj->doc, pad + sizeof(size_t) + cap * sizeof(uint32_t)) + pad;
+    size_t offset = table - obj->doc->data;
+    *(size_t*)table = cap;
+    uint32_t* slots = (uint32_t*)(table + sizeof(size_t));
+    memset(slots, 0, cap * sizeof(uint32_t));
+
+    for (size_t i = 0; i < length; i++) {
+        soa_obj_entry_t* e = _obj_entry(obj, i);
+        if(!e->hash){
+            size_t k_len;
+            const char* k = _obj_key(obj, e, &k_len);
+            e->hash = soa_key_hash(k, k_len);
+        }
+        size_t slot = e->hash & (cap - 1);
+        while(slots[slot]){
+            slot = (slot + 1) & (cap - 1);
+        }
+        slots[slot] = (uint32_t)(i + 1);
+    }
+    _obj_header(obj)->index = offset;
+}
+
+size_t    soa_obj_find_key(soa_obj_t* obj, const char* key, size_t len){
+    return _soa_obj_find_key_hash(obj, key, len, soa_key_hash(key, len));
+}
+
+size_t    _soa_obj_find_key_hash(soa_obj_t* obj, const char* key, size_t len, uint32_t hash){
+    size_t length = soa_obj_length(obj);
+
+    // lookups only read the doc, objects without an index are scanned
+    if(_obj_header(obj)->index){
+        uint8_t* table = obj->doc->data + _obj_header(obj)->index;
+        size_t cap = *(size_t*)table;
+        uint32_t* slots = (uint32_t*)(table + sizeof(size_t));
+        for (size_t slot = hash & (cap - 1); slots[slot]; slot = (slot + 1) & (cap - 1)) {
+            size_t i = slots[slot] - 1;
+            if(_obj_key_eq(obj, _obj_entry(obj, i), key, len, hash)){
+                return i;
+            }
+        }
+        return length;
+    }
+
+    if(len < 8){
+        // short keys are compared as one integer
+        char probe_sso[8];
+        _sso_set(probe_sso, key, len);
+        uint64_t probe;
+        memcpy(&probe, probe_sso, sizeof(probe));
+        for (size_t i = 0; i < length; i++) {
+            soa_obj_entry_t* e = _obj_entry(obj, i);
+            uint64_t k;
+            memcpy(&k, e->key.sso, sizeof(k));
+            // escaped keys can be short and still live outside the entry
+            if(e->sso == SOA_KEY_SSO ? k == probe : _obj_key_eq(obj, e, key, len, hash)){
+                return i;
+            }
+        }
+        return length;
+    }
+
+    for (size_t i = 0; i < length; i++) {
+        soa_obj_entry_t* e = _obj_entry(obj, i);
+        if(e->sso != SOA_KEY_SSO && _obj_key_eq(obj, e, key, len, hash)){
+            return i;
+        }
+    }
+    return length;
+}
+
+static void _build_index_arr(soa_arr_t* arr);
+
+static void _build_index_obj(soa_obj_t* obj){
+    size_t length = soa_obj_length(obj);
+    if(length >= SOA_OBJ_INDEX_THRESHOLD && !_obj_header(obj)->index){
+        soa_obj_build_index(obj);
+    }
+    for (size_t i = 0; i < length; i++) {
+        soa_val_t v = soa_obj_val_at_index(obj, i);
+        if(soa_val_type(&v) == SOA_TYPE_OBJ){
+            soa_obj_t o = soa_val_obj(&v);
+            _build_index_obj(&o);
+        }
+        else if(soa_val_type(&v) == SOA_TYPE_ARR){
+            soa_arr_t a = soa_val_arr(&v);
+            _build_index_arr(&a);
         }
     }
-    return (soa_val_t){0};
+}
+
+static void _build_index_arr(soa_arr_t* arr){
+    size_t length = soa_arr_length(arr);
+    for (size_t i = 0; i < length; i++) {
+        soa_val_t v = soa_arr_val_at(arr, i);
+        if(soa_val_type(&v) == SOA_TYPE_OBJ){
+            soa_obj_t o = soa_val_obj(&v);
+            _build_index_obj(&o);
+        }
+        else if(soa_val_type(&v) == SOA_TYPE_ARR){
+            soa_arr_t a = soa_val_arr(&v);
+            _build_index_arr(&a);
+        }
+    }
+}
+
+void      soa_doc_build_index(soa_doc_t* doc){
+    if(doc->root_type == SOA_ROOT_OBJ){
+        soa_obj_t obj = soa_doc_root_obj(doc);
+        _build_index_obj(&obj);
+    }
+    else if(doc->root_type == SOA_ROOT_ARR){
+        soa_arr_t arr = soa_doc_root_arr(doc);
+        _build_index_arr(&arr);
+    }
+}
+
+soa_val_t soa_obj_val_at_key(soa_obj_t* obj, const char* key){
+    return soa_obj_val_at_index(obj, soa_obj_find_key(obj, key, strlen(key)));
 }
 
 size_t    soa_arr_length(soa_arr_t* arr){
-    return *(size_t*)(arr->doc->data + arr->data);
+    return *(size_t*)(arr->doc->data + arr->data) & _SOA_LENGTH;
 }
 
 soa_val_t soa_arr_val_at(soa_arr_t* arr, size_t index){
     if(index >= soa_arr_length(arr)) return (soa_val_t){0};
+    size_t word = *(size_t*)(arr->doc->data + arr->data);
+    if(word & _SOA_SHAPE){
+        _view_t v = _view(arr->doc->data, arr->data, 0);
+        return (soa_val_t){
+            .doc = arr->doc,
+            .data = v.values + index * v.vstride,
+            // values of a packed array share one tag, marked to find the array again
+            .tag = word & _SOA_PACKED ? _SOA_PACKED | arr->data : v.tags + index
+        };
+    }
     return (soa_val_t){
         .doc = arr->doc,
         .data = arr->data + index * sizeof(soa_arr_entry_t) + sizeof(size_t),
     };
 }
 
+const uint8_t*    soa_arr_tags  (soa_arr_t* arr){
+    if(!(*(size_t*)(arr->doc->data + arr->data) & _SOA_COLUMNS)) return NULL;
+    return arr->doc->data + _view(arr->doc->data, arr->data, 0).tags;
+}
+
+const soa_valu_t* soa_arr_values(soa_arr_t* arr){
+    if(!(*(size_t*)(arr->doc->data + arr->data) & _SOA_COLUMNS)) return NULL;
+    return (const soa_valu_t*)(arr->doc->data + _view(arr->doc->data, arr->data, 0).values);
+}
+
+static const void* _arr_packed(soa_arr_t* arr, uint8_t type, size_t* len){
+    size_t word = *(size_t*)(arr->doc->data + arr->data);
+    if(!(word & _SOA_PACKED) || arr->doc->data[arr->data + sizeof(size_t)] != type) return NULL;
+    *len = word & _SOA_LENGTH;
+    return arr->doc->data + arr->data + 2 * sizeof(size_t);
+}
+
+const int64_t*    soa_arr_ints  (soa_arr_t* arr, size_t* len){
+    return _arr_packed(arr, SOA_TYPE_INT, len);
+}
+
+const uint64_t*   soa_arr_uints (soa_arr_t* arr, size_t* len){
+    return _arr_packed(arr, SOA_TYPE_UINT, len);
+}
+
+const double*     soa_arr_floats(soa_arr_t* arr, size_t* len){
+    return _arr_packed(arr, SOA_TYPE_FLOAT, len);
+}
+
+const float*      soa_arr_f32s  (soa_arr_t* arr, size_t* len){
+    return _arr_packed(arr, SOA_TYPE_F32, len);
+}
+
+const uint8_t*    soa_obj_tags  (soa_obj_t* obj){
+    if(!(_obj_header(obj)->length & _SOA_COLUMNS)) return NULL;
+    return obj->doc->data + _view(obj->doc->data, obj->data, 1).tags;
+}
+
+const soa_valu_t* soa_obj_values(soa_obj_t* obj){
+    if(!(_obj_header(obj)->length & _SOA_COLUMNS)) return NULL;
+    return (const soa_valu_t*)(obj->doc->data + _view(obj->doc->data, obj->data, 1).values);
+}
+
+// Growing containers
+
+// Columns and packed arrays go back to rows at the end of the doc before
+// the container changes shape
+static size_t _container_rows(soa_doc_t* doc, size_t data, int obj){
+    size_t head = _head_size(obj);
+    size_t entry = _entry_size(obj);
+    size_t length = *(size_t*)(doc->data + data) & _SOA_LENGTH;
+    size_t pad = (sizeof(size_t) - doc->size % sizeof(size_t)) % sizeof(size_t);
+    size_t moved = _soa_doc_grow(doc, pad + head + length * entry) + pad - doc->data;
+
+    _view_t v = _view(doc->data, data, obj);
+    uint8_t* block = doc->data + moved;
+    memcpy(block, doc->data + data, head);
+    *(size_t*)block = length;
+    memset(block + head, 0, length * entry);
+    for (size_t i = 0; i < length; i++) {
+        uint8_t* e = block + head + i * entry;
+        if(obj){
+            memcpy(e + sizeof(soa_valu_t), doc->data + v.keys + i * v.kstride, _SOA_KEY_RECORD);
+        }
+        memcpy(e, doc->data + v.values + i * v.vstride, v.vsize);
+        e[sizeof(soa_valu_t)] = doc->data[v.tags + i * v.tstride];
+    }
+    *(size_t*)(doc->data + data) = _SOA_MOVED | moved;
+    return moved;
+}
+
+// Makes room for one more entry, in place when the container ends the
+// doc, otherwise it moves to the end with twice the room
+static size_t _container_reserve(soa_doc_t* doc, size_t data, int obj){
+    size_t head = _head_size(obj);
+    size_t entry = _entry_size(obj);
+    if(*(size_t*)(doc->data + data) & _SOA_SHAPE){
+        data = _container_rows(doc, data, obj);
+    }
+    size_t word = *(size_t*)(doc->data + data);
+    size_t length = word & _SOA_LENGTH;
+    size_t cap = word & _SOA_SLACK ? _slack_cap(length) : length;
+    if(length < cap){
+        return data;
+    }
+
+    size_t new_cap = _slack_cap(length + 1);
+    if(data + head + cap * entry == doc->size){
+        _soa_doc_grow(doc, (new_cap - cap) * entry);
+    }
+    else{
+        size_t pad = (sizeof(size_t) - doc->size % sizeof(size_t)) % sizeof(size_t);
+        uint8_t* block = _soa_doc_grow(doc, pad + head + new_cap * entry) + pad;
+        memcpy(block, doc->data + data, head + length * entry);
+        size_t moved = block - doc->data;
+        *(size_t*)(doc->data + data) = _SOA_MOVED | moved;
+        data = moved;
+    }
+    *(size_t*)(doc->data + data) = length | _SOA_SLACK;
+    return data;
+}
+
+// Opens a null entry at index, the length is bumped by the caller
+static uint8_t* _container_open(soa_doc_t* doc, size_t data, size_t head, size_t entry, size_t index){
+    size_t length = *(size_t*)(doc->data + data) & _SOA_LENGTH;
+    uint8_t* at = doc->data + data + head + index * entry;
+    memmove(at + entry, at, (length - index) * entry);
+    memset(at, 0, entry);
+    ((soa_arr_entry_t*)at)->value.b = SOA_BOOL_NULL;
+    ((soa_arr_entry_t*)at)->type = SOA_TYPE_BOOL;
+    return at;
+}
+
+soa_val_t soa_arr_push  (soa_arr_t* arr){
+    return soa_arr_insert(arr, soa_arr_length(arr));
+}
+
+soa_val_t soa_arr_insert(soa_arr_t* arr, size_t index){
+    size_t length = soa_arr_length(arr);
+    if(index > length) return (soa_val_t){0};
+
+    arr->data = _container_reserve(arr->doc, arr->data, 0);
+    _container_open(arr->doc, arr->data, sizeof(size_t), sizeof(soa_arr_entry_t), index);
+    *(size_t*)(arr->doc->data + arr->data) += 1;
+    return soa_arr_val_at(arr, index);
+}
+
+void      soa_arr_erase (soa_arr_t* arr, size_t index){
+    size_t length = soa_arr_length(arr);
+    if(index >= length) return;
+    if(*(size_t*)(arr->doc->data + arr->data) & _SOA_SHAPE){
+        arr->data = _container_rows(arr->doc, arr->data, 0);
+    }
+
+    uint8_t* at = arr->doc->data + arr->data + sizeof(size_t) + index * sizeof(soa_arr_entry_t);
+    memmove(at, at + sizeof(soa_arr_entry_t), (length - index - 1) * sizeof(soa_arr_entry_t));
+    *(size_t*)(arr->doc->data + arr->data) -= 1;
+}
+
+soa_val_t soa_obj_push  (soa_obj_t* obj, const char* key, size_t len){
+    return soa_obj_insert(obj, soa_obj_length(obj), key, len);
+}
+
+soa_val_t soa_obj_insert(soa_obj_t* obj, size_t index, const char* key, size_t len){
+    size_t length = soa_obj_length(obj);
+    if(index > length) return (soa_val_t){0};
+
+    // key can come from this doc, growing may move it
+    uint8_t* data = obj->doc->data;
+    int inside = (const uint8_t*)key >= data && (const uint8_t*)key < data + obj->doc->size;
+    size_t offset = (const uint8_t*)key - data;
+
+    obj->data = _container_reserve(obj->doc, obj->data, 1);
+    _container_open(obj->doc, obj->data, sizeof(soa_obj_header_t), sizeof(soa_obj_entry_t), index);
+    _obj_header(obj)->length += 1;
+    if(inside){
+        key = (const char*)obj->doc->data + offset;
+    }
+    // drops the key index, appends put the key into it when there is room
+    size_t table = _obj_header(obj)->index;
+    soa_obj_set_key_at_n(obj, index, key, len);
+    if(table && index == length && *(size_t*)(obj->doc->data + table) >= (length + 1) * 2){
+        size_t cap = *(size_t*)(obj->doc->data + table);
+        uint32_t* slots = (uint32_t*)(obj->doc->data + table + sizeof(size_t));
+        size_t slot = _obj_entry(obj, index)->hash & (cap - 1);
+        while(slots[slot]){
+            slot = (slot + 1) & (cap - 1);
+        }
+        slots[slot] = (uint32_t)(index + 1);
+        _obj_header(obj)->index = table;
+    }
+    return soa_obj_val_at_index(obj, index);
+}
+
+void      soa_obj_erase (soa_obj_t* obj, size_t index){
+    size_t length = soa_obj_length(obj);
+    if(index >= length) return;
+    if(_obj_header(obj)->length & _SOA_COLUMNS){
+        obj->data = _container_rows(obj->doc, obj->data, 1);
+    }
+
+    soa_obj_entry_t* at = _obj_entry(obj, index);
+    memmove(at, at + 1, (length - index - 1) * sizeof(soa_obj_entry_t));
+    _obj_header(obj)->length -= 1;
+    _obj_header(obj)->index = 0;
+}
+
+inline static size_t _val_tag(const soa_val_t* val){
+    if(val->tag & _SOA_PACKED){
+        return (val->tag & ~_SOA_PACKED) + sizeof(size_t);
+    }
+    return val->tag ? val->tag : val->data + sizeof(soa_valu_t);
+}
+
+// Sets the type and returns where the value goes. A value of a packed
+// array taking another type moves the array back to rows, val still
+// points at the old place.
+static size_t _val_slot(const soa_val_t* val, soa_type_t type){
+    if(val->tag & _SOA_PACKED && soa_val_type(val) != type){
+        size_t arr = val->tag & ~_SOA_PACKED;
+        _view_t v = _view(val->doc->data, arr, 0);
+        size_t index = (val->data - v.values) / v.vstride;
+        size_t rows = _container_rows(val->doc, arr, 0);
+        size_t slot = rows + sizeof(size_t) + index * sizeof(soa_arr_entry_t);
+        val->doc->data[slot + sizeof(soa_valu_t)] = type;
+        return slot;
+    }
+    val->doc->data[_val_tag(val)] = type;
+    return val->data;
+}
+
 soa_type_t soa_val_type (const soa_val_t* val) {
-    return (soa_type_t)*(val->doc->data + val->data + sizeof(soa_valu_t));
+    return (soa_type_t)val->doc->data[_val_tag(val)];
 }
 
 soa_bool_t soa_val_bool (const soa_val_t* val){
@@ -171,6 +937,8 @@ soa_bool_t soa_val_bool (const soa_val_t* val){
             return (soa_bool_t)*(uint64_t*)(val->doc->data + val->data) > 0;
         case SOA_TYPE_FLOAT:
             return (soa_bool_t)*(double*)(val->doc->data + val->data) > 0;
+        case SOA_TYPE_F32:
+            return (soa_bool_t)*(float*)(val->doc->data + val->data) > 0;
         default:
             return SOA_BOOL_NULL;
     };
@@ -184,6 +952,8 @@ int64_t    soa_val_int  (const soa_val_t* val){
             return (int64_t)*(uint64_t*)(val->doc->data + val->data);
         case SOA_TYPE_FLOAT:
             return (int64_t)*(double*)(val->doc->data + val->data);
+        case SOA_TYPE_F32:
+            return (int64_t)*(float*)(val->doc->data + val->data);
         case SOA_TYPE_BOOL:
             return (int64_t)*(soa_bool_t*)(val->doc->data + val->data);
         default:
@@ -199,6 +969,8 @@ uint64_t   soa_val_uint (const soa_val_t* val){
             return (uint64_t)*(int64_t*)(val->doc->data + val->data);
         case SOA_TYPE_FLOAT:
             return (uint64_t)*(double*)(val->doc->data + val->data);
+        case SOA_TYPE_F32:
+            return (uint64_t)*(float*)(val->doc->data + val->data);
         case SOA_TYPE_BOOL:
             return (uint64_t)*(soa_bool_t*)(val->doc->data + val->data);
         default:
@@ -210,6 +982,8 @@ double      soa_val_float(const soa_val_t* val){
     switch(soa_val_type(val)) {
         case SOA_TYPE_FLOAT:
             return *(double*)(val->doc->data + val->data);
+        case SOA_TYPE_F32:
+            return *(float*)(val->doc->data + val->data);
         case SOA_TYPE_INT:
             return (double)*(int64_t*)(val->doc->data + val->data);
         case SOA_TYPE_UINT:
@@ -230,61 +1004,749 @@ char*      soa_val_str  (const soa_val_t* val){
     else if(type == SOA_TYPE_SSO){
         return (char*)(val->doc->data + val->data);
     }
+    else if(type == SOA_TYPE_REF){
+        soa_ref_t ref = ((soa_valu_t*)(val->doc->data + val->data))->r;
+        size_t str = soa_doc_add_str_n(val->doc, val->doc->source + ref.offset, ref.length);
+        *(size_t*)(val->doc->data + val->data) = str;
+        soa_val_set_type(val, SOA_TYPE_STR);
+        return (char*)(val->doc->data + str);
+    }
 
     return 0;
 }
 
+const char* soa_val_str_n(const soa_val_t* val, size_t* len){
+    uint8_t* data = val->doc->data + val->data;
+    switch(soa_val_type(val)){
+        case SOA_TYPE_STR:{
+            const char* str = (char*)(val->doc->data + *(size_t*)data);
+            *len = _str_len(str);
+            return str;
+        }
+        case SOA_TYPE_SSO:
+            *len = 7 - data[7];
+            return (char*)data;
+        case SOA_TYPE_REF:{
+            soa_ref_t ref = ((soa_valu_t*)data)->r;
+            *len = ref.length;
+            return val->doc->source + ref.offset;
+        }
+        default:
+            *len = 0;
+            return 0;
+    }
+}
+
 soa_obj_t  soa_val_obj  (const soa_val_t* val){
     if(soa_val_type(val) != SOA_TYPE_OBJ) return (soa_obj_t){0};
-    return (soa_obj_t){.doc = val->doc, .data = *(size_t*)(val->doc->data + val->data)};
+    return (soa_obj_t){.doc = val->doc, .data = _resolve(val->doc, *(size_t*)(val->doc->data + val->data))};
 }
 
 soa_arr_t  soa_val_arr  (const soa_val_t* val){
     if(soa_val_type(val) != SOA_TYPE_ARR) return (soa_arr_t){0};
-    return (soa_arr_t){.doc = val->doc, .data = *(size_t*)(val->doc->data + val->data)};
+    return (soa_arr_t){.doc = val->doc, .data = _resolve(val->doc, *(size_t*)(val->doc->data + val->data))};
 }
 
 void soa_val_set_type (const soa_val_t* val, const soa_type_t type){
-    memcpy(val->doc->data + val->data + sizeof(soa_valu_t), &type, sizeof(uint8_t));
+    _val_slot(val, type);
 }
 
 void soa_val_set_bool (const soa_val_t* val, const soa_bool_t value){
-    soa_val_set_type(val, SOA_TYPE_BOOL);
-    *(soa_bool_t*)(val->doc->data + val->data) = value;    
+    size_t at = _val_slot(val, SOA_TYPE_BOOL);
+    *(soa_bool_t*)(val->doc->data + at) = value;    
 }
 
 void soa_val_set_int  (const soa_val_t* val, const int64_t    value){
-    soa_val_set_type(val, SOA_TYPE_INT);
-    *(int64_t*)(val->doc->data + val->data) = value;  
+    size_t at = _val_slot(val, SOA_TYPE_INT);
+    *(int64_t*)(val->doc->data + at) = value;  
 }
 
 void soa_val_set_uint (const soa_val_t* val, const uint64_t   value){
-    soa_val_set_type(val, SOA_TYPE_UINT);
-    *(uint64_t*)(val->doc->data + val->data) = value;  
+    size_t at = _val_slot(val, SOA_TYPE_UINT);
+    *(uint64_t*)(val->doc->data + at) = value;  
 }
 
 void soa_val_set_float(const soa_val_t* val, const double     value){
-    soa_val_set_type(val, SOA_TYPE_FLOAT);
-    *(double*)(val->doc->data + val->data) = value;  
+    size_t at = _val_slot(val, SOA_TYPE_FLOAT);
+    *(double*)(val->doc->data + at) = value;  
+}
+
+void soa_val_set_f32  (const soa_val_t* val, const float      value){
+    size_t at = _val_slot(val, SOA_TYPE_F32);
+    *(float*)(val->doc->data + at) = value;  
 }
 
 void soa_val_set_str  (const soa_val_t* val, const char*      value){
-    if(strlen(value) < sizeof(soa_valu_t)){
-        soa_val_set_type(val, SOA_TYPE_SSO);
-        strcpy((char*)&val->data, value);
+    soa_val_set_str_n(val, value, strlen(value));
+}
+
+void soa_val_set_str_n(const soa_val_t* val, const char* value, size_t len){
+    if(len < sizeof(soa_valu_t)){
+        size_t at = _val_slot(val, SOA_TYPE_SSO);
+        _sso_set((char*)(val->doc->data + at), value, len);
     }
     else{
-        soa_val_set_type(val, SOA_TYPE_STR);
-        *(size_t*)val->data = soa_doc_add_str(val->doc, value);  
+        size_t str = soa_doc_add_str_n(val->doc, value, len);
+        size_t at = _val_slot(val, SOA_TYPE_STR);
+        *(size_t*)(val->doc->data + at) = str;
     }
 }
 
 void soa_val_set_obj  (const soa_val_t* val, const soa_obj_t* value){
-    soa_val_set_type(val, SOA_TYPE_OBJ);
-    *(size_t*)(val->doc->data + val->data) = value->data;
+    size_t at = _val_slot(val, SOA_TYPE_OBJ);
+    *(size_t*)(val->doc->data + at) = value->data;
 }
 
 void soa_val_set_arr  (const soa_val_t* val, const soa_arr_t* value){
-    soa_val_set_type(val, SOA_TYPE_ARR);
-    *(size_t*)(val->doc->data + val->data) = value->data;
+    size_t at = _val_slot(val, SOA_TYPE_ARR);
+    *(size_t*)(val->doc->data + at) = value->data;
+}
+
+// Compaction
+//
+// Everything reachable from the root is copied into a new buffer in pre
+// order, the same walk runs once without a buffer to measure it. Once
+// moved, a container or string leaves its new offset in the old buffer
+// so anything shared stays shared.
+
+typedef enum {
+    _COMPACT_ARR = 0,
+    _COMPACT_OBJ,
+    _COMPACT_STR,
+    _COMPACT_INDEX
+} _compact_kind_t;
+
+typedef struct {
+    size_t old;
+    size_t patch; // new offset of the slot pointing at it, SIZE_MAX for the root
+    uint8_t type;
+} _compact_item_t;
+
+typedef struct {
+    uint8_t* old;
+    uint8_t* moved; // one byte per old byte
+    uint8_t* data;  // NULL while measuring
+    int columns;
+    int pack; // SOA_COMPACT_PACKED and SOA_COMPACT_F32
+    size_t cursors[4];
+    size_t* at[4];  // cursor of each kind, all the same one when interleaved
+    size_t root;
+
+    const soa_allocator_t* alloc;
+    _compact_item_t* stack;
+    size_t n;
+    size_t cap;
+    int failed; // the stack could not grow
+} _compact_t;
+
+inline static size_t _align_size(size_t at){
+    return at + (sizeof(size_t) - at % sizeof(size_t)) % sizeof(size_t);
+}
+
+static size_t _compact_place(_compact_t* c, _compact_kind_t kind, size_t size){
+    size_t* at = c->at[kind];
+    if(kind != _COMPACT_STR){
+        *at = _align_size(*at);
+    }
+    size_t pos = *at;
+    *at += size;
+    return pos;
+}
+
+static size_t _compact_str(_compact_t* c, size_t old){
+    if(c->moved[old]){
+        size_t pos = 0;
+        if(c->data){
+            memcpy(&pos, c->old + old - sizeof(size_t), sizeof(size_t));
+        }
+        return pos;
+    }
+    c->moved[old] = 1;
+    size_t len = _str_len((const char*)c->old + old);
+    size_t pos = _compact_place(c, _COMPACT_STR, sizeof(size_t) + len + 1) + sizeof(size_t);
+    if(c->data){
+        memcpy(c->data + pos - sizeof(size_t), c->old + old - sizeof(size_t), sizeof(size_t) + len + 1);
+        memcpy(c->old + old - sizeof(size_t), &pos, sizeof(size_t));
+    }
+    return pos;
+}
+
+// Type an array packs as, 0 when it keeps entries
+static uint8_t _compact_packed(const _compact_t* c, _view_t v, size_t length){
+    if(!c->pack || !length){
+        return 0;
+    }
+    int ints = 0, uints = 0, floats = 0, f32s = 0, big = 0;
+    for (size_t i = 0; i < length; i++) {
+        switch(c->old[v.tags + i * v.tstride]){
+        case SOA_TYPE_INT:
+            ints = 1;
+            break;
+        case SOA_TYPE_UINT:{
+            uint64_t u;
+            memcpy(&u, c->old + v.values + i * v.vstride, sizeof(u));
+            uints = 1;
+            big |= u > INT64_MAX;
+            break;
+        }
+        case SOA_TYPE_FLOAT:
+            floats = 1;
+            break;
+        case SOA_TYPE_F32:
+            f32s = 1;
+            break;
+        default:
+            return 0;
+        }
+    }
+    if(ints || uints){
+        if(floats || f32s || (ints && big)){
+            return 0;
+        }
+        return ints ? SOA_TYPE_INT : SOA_TYPE_UINT;
+    }
+    return c->pack & SOA_COMPACT_F32 || !floats ? SOA_TYPE_F32 : SOA_TYPE_FLOAT;
+}
+
+static void _compact_number(uint8_t* to, uint8_t type, const uint8_t* from, uint8_t from_type){
+    soa_valu_t v = {0};
+    memcpy(&v, from, _packed_width(from_type));
+    if(type == SOA_TYPE_F32 && from_type == SOA_TYPE_FLOAT){
+        v.f32 = (float)v.f;
+    }
+    else if(type == SOA_TYPE_FLOAT && from_type == SOA_TYPE_F32){
+        v.f = v.f32;
+    }
+    memcpy(to, &v, _packed_width(type));
+}
+
+inline static void _compact_patch(_compact_t* c, size_t patch, size_t pos){
+    if(patch == SIZE_MAX){
+        c->root = pos;
+    }
+    else if(c->data){
+        memcpy(c->data + patch, &pos, sizeof(size_t));
+    }
+}
+
+static void _compact_container(_compact_t* c, _compact_item_t it){
+    size_t word;
+    while(!c->moved[it.old] && ((word = *(size_t*)(c->old + it.old)) & _SOA_MOVED)){
+        it.old = word & ~_SOA_MOVED;
+    }
+    if(c->moved[it.old]){
+        size_t pos = 0;
+        memcpy(&pos, c->old + it.old, sizeof(size_t));
+        _compact_patch(c, it.patch, pos);
+        return;
+    }
+    c->moved[it.old] = 1;
+
+    int obj = it.type == SOA_TYPE_OBJ;
+    size_t head = _head_size(obj);
+    soa_obj_header_t h = {0};
+    memcpy(&h, c->old + it.old, head);
+    _view_t from = _view(c->old, it.old, obj);
+    h.length &= _SOA_LENGTH; // slack is left behind
+    uint8_t packed = obj ? 0 : _compact_packed(c, from, h.length);
+    size_t bytes = head;
+    if(packed){
+        word = h.length | _SOA_PACKED;
+        bytes += sizeof(size_t) + h.length * _packed_width(packed);
+    }
+    else if(c->columns){
+        word = h.length | _SOA_COLUMNS;
+        bytes += _columns_size(h.length, obj);
+    }
+    else{
+        word = h.length;
+        bytes += h.length * _entry_size(obj);
+    }
+    size_t pos = _compact_place(c, obj ? _COMPACT_OBJ : _COMPACT_ARR, bytes);
+    _view_t to = _view_word(word, packed, pos, obj);
+
+    size_t index = 0;
+    if(obj && h.index){
+        size_t slots = *(size_t*)(c->old + h.index);
+        size_t index_bytes = sizeof(size_t) + slots * sizeof(uint32_t);
+        index = _compact_place(c, _COMPACT_INDEX, index_bytes);
+        if(c->data){
+            memcpy(c->data + index, c->old + h.index, index_bytes);
+        }
+    }
+
+    // entries are patched in their new place, measuring reads the old one
+    uint8_t* base = c->old;
+    _view_t at = from;
+    if(c->data){
+        memset(c->data + pos, 0, bytes);
+        memcpy(c->data + pos, &word, sizeof(size_t));
+        if(obj){
+            ((soa_obj_header_t*)(c->data + pos))->index = index;
+        }
+        for (size_t i = 0; i < h.length; i++) {
+            if(obj){
+                memcpy(c->data + to.keys + i * to.kstride, c->old + from.keys + i * from.kstride, _SOA_KEY_RECORD);
+            }
+            uint8_t type = c->old[from.tags + i * from.tstride];
+            if(packed){
+                _compact_number(c->data + to.values + i * to.vstride, packed, c->old + from.values + i * from.vstride, type);
+                type = packed;
+            }
+            else{
+                memcpy(c->data + to.values + i * to.vstride, c->old + from.values + i * from.vstride, from.vsize);
+            }
+            c->data[to.tags + i * to.tstride] = type;
+        }
+        memcpy(c->old + it.old, &pos, sizeof(size_t));
+        base = c->data;
+        at = to;
+    }
+    _compact_patch(c, it.patch, pos);
+
+    for (size_t i = 0; i < h.length; i++) {
+        soa_valu_t* value = (soa_valu_t*)(base + at.values + i * at.vstride);
+        if(obj){
+            soa_obj_entry_t* e = (soa_obj_entry_t*)(base + at.keys + i * at.kstride - sizeof(soa_valu_t));
+            if(e->sso == SOA_KEY_STR){
+                size_t str = _compact_str(c, e->key.str);
+                if(c->data){
+                    e->key.str = str;
+                }
+            }
+        }
+        if(base[at.tags + i * at.tstride] == SOA_TYPE_STR){
+            size_t str = _compact_str(c, value->s);
+            if(c->data){
+                value->s = str;
+            }
+        }
+    }
+
+    // pushed last to first so the first child comes out next
+    for (size_t i = h.length; i-- > 0;) {
+        uint8_t type = base[at.tags + i * at.tstride];
+        if(type != SOA_TYPE_OBJ && type != SOA_TYPE_ARR){
+            continue;
+        }
+        if(c->n == c->cap){
+            size_t cap = c->cap ? c->cap * 2 : 64;
+            _compact_item_t* stack = _soa_realloc(c->alloc, c->stack, c->cap * sizeof(_compact_item_t), cap * sizeof(_compact_item_t));
+            if(!stack){
+                c->failed = 1;
+                return;
+            }
+            c->stack = stack;
+            c->cap = cap;
+        }
+        size_t child = ((soa_valu_t*)(base + at.values + i * at.vstride))->o;
+        c->stack[c->n++] = (_compact_item_t){child, to.values + i * to.vstride, type};
+    }
+}
+
+static void _compact_run(_compact_t* c, soa_doc_t* doc){
+    c->n = 0;
+    _compact_container(c, (_compact_item_t){doc->root, SIZE_MAX, doc->root_type});
+    while(c->n && !c->failed){
+        _compact_container(c, c->stack[--c->n]);
+    }
+}
+
+size_t    soa_doc_compact(soa_doc_t* doc, soa_compact_t layout){
+    size_t old_size = doc->size;
+    uint8_t* data = NULL;
+    size_t size = 0;
+    size_t root = 0;
+
+    if(doc->root_type){
+        int grouped = layout & SOA_COMPACT_GROUPED;
+        _compact_t c = {
+            .old = doc->data,
+            .moved = _soa_alloc(doc->alloc, doc->size),
+            .columns = !!(layout & SOA_COMPACT_COLUMNS),
+            .pack = layout & SOA_COMPACT_PACKED ? layout & (SOA_COMPACT_PACKED | SOA_COMPACT_F32) : 0,
+            .alloc = doc->alloc
+        };
+        for (int k = 0; k < 4; k++) {
+            c.at[k] = grouped ? c.cursors + k : c.cursors;
+        }
+        if(c.moved){
+            memset(c.moved, 0, doc->size);
+            _compact_run(&c, doc);
+        }
+
+        if(grouped){
+            // arrays, objects, strings and key indexes, the parser's order
+            size_t arrs = c.cursors[_COMPACT_ARR];
+            size_t objs = c.cursors[_COMPACT_OBJ];
+            size_t strs = c.cursors[_COMPACT_STR];
+            size_t indexes = c.cursors[_COMPACT_INDEX];
+            // each region starts aligned like it was measured, packed
+            // singles can leave a region 4 bytes short of a word
+            c.cursors[_COMPACT_ARR] = 0;
+            c.cursors[_COMPACT_OBJ] = _align_size(arrs);
+            c.cursors[_COMPACT_STR] = _align_size(c.cursors[_COMPACT_OBJ] + objs);
+            c.cursors[_COMPACT_INDEX] = _align_size(c.cursors[_COMPACT_STR] + strs);
+            size = c.cursors[_COMPACT_INDEX] + indexes;
+        }
+        else{
+            size = c.cursors[0];
+            c.cursors[0] = 0;
+        }
+
+        // placing leaves new offsets in the old buffer, so everything it
+        // needs is allocated before, the stack grew as deep while measuring
+        if(c.moved && !c.failed){
+            c.data = data = _soa_alloc(doc->alloc, size);
+        }
+        if(data){
+            memset(c.moved, 0, doc->size);
+            _compact_run(&c, doc);
+            root = c.root;
+        }
+
+        if(c.moved){
+            _soa_free(doc->alloc, c.moved, doc->size);
+        }
+        if(c.stack){
+            _soa_free(doc->alloc, c.stack, c.cap * sizeof(_compact_item_t));
+        }
+        if(!data){
+            soa_error_push("Out of memory!", 42);
+            return 0;
+        }
+    }
+
+    if(doc->mapped){
+        _doc_unmap(doc);
+    }
+    else{
+        _soa_free(doc->alloc, doc->data, doc->cap);
+    }
+    doc->data = data;
+    doc->size = size;
+    doc->cap = size;
+    doc->root = root;
+    return old_size > size ? old_size - size : 0;
+}
+
+// Snapshots
+
+static void _own_strings_arr(soa_arr_t* arr);
+
+static void _own_strings_val(soa_val_t* v);
+
+static void _own_strings_obj(soa_obj_t* obj){
+    size_t length = soa_obj_length(obj);
+    for (size_t i = 0; i < length; i++) {
+        if(_obj_entry(obj, i)->sso == SOA_KEY_REF){
+            soa_obj_key_at(obj, i);
+        }
+        soa_val_t v = soa_obj_val_at_index(obj, i);
+        _own_strings_val(&v);
+    }
+}
+
+static void _own_strings_arr(soa_arr_t* arr){
+    size_t length = soa_arr_length(arr);
+    for (size_t i = 0; i < length; i++) {
+        soa_val_t v = soa_arr_val_at(arr, i);
+        _own_strings_val(&v);
+    }
+}
+
+static void _own_strings_val(soa_val_t* v){
+    switch(soa_val_type(v)){
+    case SOA_TYPE_REF:
+        soa_val_str(v);
+        break;
+    case SOA_TYPE_OBJ:{
+        soa_obj_t o = soa_val_obj(v);
+        _own_strings_obj(&o);
+        break;
+    }
+    case SOA_TYPE_ARR:{
+        soa_arr_t a = soa_val_arr(v);
+        _own_strings_arr(&a);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+// Four lanes so it keeps up with reading the file
+static uint64_t _snapshot_checksum(const uint8_t* data, size_t size){
+    uint64_t h[4] = {
+        0x9E3779B97F4A7C15ull ^ size, 0xC2B2AE3D27D4EB4Full,
+        0x165667B19E3779F9ull, 0x27D4EB2F165667C5ull
+    };
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        for (int l = 0; l < 4; l++) {
+            uint64_t w;
+            memcpy(&w, data + i + l * 8, 8);
+            h[l] = (h[l] ^ w) * 0xFF51AFD7ED558CCDull;
+            h[l] ^= h[l] >> 32;
+        }
+    }
+    uint64_t r = soa_key_hash((const char*)data + i, size - i);
+    for (int l = 0; l < 4; l++) {
+        r = (r ^ h[l]) * 0xBF58476D1CE4E5B9ull;
+        r ^= r >> 29;
+    }
+    return r;
+}
+
+inline static int _snapshot_str(const soa_doc_t* doc, size_t str){
+    if(str < sizeof(size_t) || str > doc->size){
+        return 0;
+    }
+    size_t len = _str_len((const char*)doc->data + str);
+    return len < doc->size - str && doc->data[str + len] == 0;
+}
+
+inline static int _snapshot_scalar(const soa_doc_t* doc, const soa_valu_t* v, uint8_t type){
+    switch(type){
+    case SOA_TYPE_BOOL:
+        return v->b <= SOA_BOOL_NULL;
+    case SOA_TYPE_INT:
+    case SOA_TYPE_UINT:
+    case SOA_TYPE_FLOAT:
+    case SOA_TYPE_F32:
+        return 1;
+    case SOA_TYPE_STR:
+        return _snapshot_str(doc, v->s);
+    case SOA_TYPE_SSO:
+        return (uint8_t)v->sso[7] <= 7;
+    default:
+        return 0;
+    }
+}
+
+typedef struct {
+    size_t offset;
+    uint8_t type;
+} _snapshot_item_t;
+
+// Every container reachable from the root has to lie inside the doc along
+// with its strings and key index. Bytes checked are capped at the doc size,
+// so containers shared or looping through offsets can't keep it going.
+// Containers and indexes are read a word at a time and have to be aligned,
+// string lengths are copied out and can sit anywhere.
+static int _snapshot_validate(const soa_doc_t* doc){
+    if(doc->root_type == SOA_ROOT_NULL){
+        return 1;
+    }
+    if(doc->root_type != SOA_ROOT_OBJ && doc->root_type != SOA_ROOT_ARR){
+        return 0;
+    }
+
+    size_t budget = doc->size;
+    size_t cap = 64;
+    size_t n = 0;
+    _snapshot_item_t* stack = malloc(cap * sizeof(_snapshot_item_t));
+    if(!stack){
+        return 0;
+    }
+    stack[n++] = (_snapshot_item_t){doc->root, doc->root_type};
+    int ok = 1;
+
+    while(ok && n){
+        _snapshot_item_t it = stack[--n];
+        int obj = it.type == SOA_TYPE_OBJ;
+        size_t head = _head_size(obj);
+        if(it.offset % sizeof(size_t) || it.offset > doc->size || doc->size - it.offset < head){
+            ok = 0;
+            break;
+        }
+        soa_obj_header_t h = {0};
+        memcpy(&h, doc->data + it.offset, head);
+        if(h.length & _SOA_MOVED){
+            // followed like a container so loops run out of budget
+            if(budget < sizeof(size_t)){
+                ok = 0;
+                break;
+            }
+            budget -= sizeof(size_t);
+            stack[n++] = (_snapshot_item_t){h.length & ~_SOA_MOVED, it.type};
+            continue;
+        }
+        size_t shape = h.length & _SOA_SHAPE;
+        uint8_t packed = 0;
+        if(shape == _SOA_PACKED){
+            if(obj || doc->size - it.offset - head < sizeof(size_t)){
+                ok = 0;
+                break;
+            }
+            packed = doc->data[it.offset + head];
+            ok = packed == SOA_TYPE_INT || packed == SOA_TYPE_UINT || packed == SOA_TYPE_FLOAT || packed == SOA_TYPE_F32;
+        }
+        _view_t v = _view_word(h.length, packed, it.offset, obj);
+        h.length &= _SOA_LENGTH;
+        if(!ok || shape == _SOA_SHAPE || h.length > doc->size){
+            ok = 0;
+            break;
+        }
+        size_t bytes = head;
+        if(packed){
+            bytes += sizeof(size_t) + h.length * v.vsize;
+        }
+        else{
+            bytes += shape ? _columns_size(h.length, obj) : h.length * _entry_size(obj);
+        }
+        if(bytes > doc->size - it.offset || bytes > budget){
+            ok = 0;
+            break;
+        }
+        budget -= bytes;
+
+        if(h.index){
+            size_t slots;
+            if(h.index % sizeof(size_t) || h.index > doc->size || doc->size - h.index < sizeof(size_t)){
+                ok = 0;
+                break;
+            }
+            memcpy(&slots, doc->data + h.index, sizeof(size_t));
+            if(!slots || (slots & (slots - 1)) || slots > (doc->size - h.index - sizeof(size_t)) / sizeof(uint32_t) ||
+                slots * sizeof(uint32_t) > budget){
+                ok = 0;
+                break;
+            }
+            budget -= slots * sizeof(uint32_t);
+            // lookups stop at an empty slot
+            int empty = 0;
+            for (size_t i = 0; i < slots; i++) {
+                uint32_t slot;
+                memcpy(&slot, doc->data + h.index + sizeof(size_t) + i * sizeof(uint32_t), sizeof(slot));
+                ok &= slot <= h.length;
+                empty |= !slot;
+            }
+            ok &= empty;
+        }
+
+        for (size_t i = 0; ok && i < h.length; i++) {
+            soa_obj_entry_t e = {0};
+            if(obj){
+                memcpy((uint8_t*)&e + sizeof(soa_valu_t), doc->data + v.keys + i * v.kstride, _SOA_KEY_RECORD);
+            }
+            memcpy(&e.value, doc->data + v.values + i * v.vstride, v.vsize);
+            e.type = doc->data[v.tags + i * v.tstride];
+            if(obj){
+                ok = e.sso == SOA_KEY_SSO ? (uint8_t)e.key.sso[7] <= 7 :
+                    e.sso == SOA_KEY_STR && _snapshot_str(doc, e.key.str);
+            }
+            if(!ok){
+                break;
+            }
+            if(e.type == SOA_TYPE_OBJ || e.type == SOA_TYPE_ARR){
+                if(n == cap){
+                    _snapshot_item_t* grown = realloc(stack, cap * 2 * sizeof(_snapshot_item_t));
+                    if(!grown){
+                        ok = 0;
+                        break;
+                    }
+                    stack = grown;
+                    cap *= 2;
+                }
+                stack[n++] = (_snapshot_item_t){e.value.o, e.type};
+            }
+            else{
+                ok = _snapshot_scalar(doc, &e.value, e.type);
+            }
+        }
+    }
+
+    free(stack);
+    return ok;
+}
+
+static void _snapshot_error(soa_error_t* error, const char* msg, int code){
+    if(error){
+        *error = (soa_error_t){msg, code, 0};
+    }
+}
+
+int       soa_doc_save(soa_doc_t* doc, const char* path, soa_error_t* error){
+    if(doc->root_type == SOA_ROOT_OBJ){
+        soa_obj_t obj = soa_doc_root_obj(doc);
+        _own_strings_obj(&obj);
+    }
+    else if(doc->root_type == SOA_ROOT_ARR){
+        soa_arr_t arr = soa_doc_root_arr(doc);
+        _own_strings_arr(&arr);
+    }
+    soa_doc_build_index(doc);
+
+    soa_snapshot_header_t header = {
+        .version = SOA_SNAPSHOT_VERSION,
+        .endian = 0x01020304,
+        .size = doc->size,
+        .root = doc->root,
+        .checksum = _snapshot_checksum(doc->data, doc->size),
+        .root_type = doc->root_type,
+        .word_size = sizeof(size_t)
+    };
+    memcpy(header.magic, SOA_SNAPSHOT_MAGIC, sizeof(header.magic));
+
+    FILE* file = fopen(path, "wb");
+    if(!file){
+        _snapshot_error(error, "File could not be written!", 55);
+        return 0;
+    }
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+        (!doc->size || fwrite(doc->data, doc->size, 1, file) == 1);
+    ok &= fclose(file) == 0;
+    if(!ok){
+        _snapshot_error(error, "File could not be written!", 55);
+        return 0;
+    }
+    _snapshot_error(error, NULL, 0);
+    return 1;
+}
+
+soa_doc_t soa_doc_load_mmap(const char* path, soa_snapshot_flags_t flags, soa_error_t* error){
+    _soa_map_t map = _soa_map_file(path, 1);
+    if(!map.data){
+        _snapshot_error(error, "File could not be read!", 51);
+        return soa_doc_new();
+    }
+
+    soa_snapshot_header_t header;
+    if(map.size < sizeof(header)){
+        _soa_unmap_file(&map);
+        _snapshot_error(error, "Not a snapshot!", 52);
+        return soa_doc_new();
+    }
+    memcpy(&header, map.data, sizeof(header));
+    if(memcmp(header.magic, SOA_SNAPSHOT_MAGIC, sizeof(header.magic)) ||
+        header.version != SOA_SNAPSHOT_VERSION || header.endian != 0x01020304 ||
+        header.word_size != sizeof(size_t) || header.size > map.size - sizeof(header) ||
+        (header.root_type != SOA_ROOT_NULL && header.root_type != SOA_ROOT_OBJ && header.root_type != SOA_ROOT_ARR) ||
+        (header.root_type && header.root >= header.size)){
+        _soa_unmap_file(&map);
+        _snapshot_error(error, "Not a snapshot!", 52);
+        return soa_doc_new();
+    }
+
+    soa_doc_t doc = {
+        .data = (uint8_t*)map.data + sizeof(header),
+        .size = (size_t)header.size,
+        .cap = (size_t)header.size,
+        .root = (size_t)header.root,
+        .root_type = header.root_type,
+        .mapped = map.size
+    };
+    if((flags & SOA_SNAPSHOT_CHECKSUM) && _snapshot_checksum(doc.data, doc.size) != header.checksum){
+        soa_doc_free(&doc);
+        _snapshot_error(error, "Snapshot checksum mismatch!", 53);
+        return doc;
+    }
+    if((flags & SOA_SNAPSHOT_VALIDATE) && !_snapshot_validate(&doc)){
+        soa_doc_free(&doc);
+        _snapshot_error(error, "Snapshot is corrupt!", 54);
+        return doc;
+    }
+    _snapshot_error(error, NULL, 0);
+    return doc;
 }
@@ -33,18 +33,58 @@ extern "C" {
 #define SOA_DOC_GROW_FACTOR 2
 #endif
 
+// soa_doc_build_index indexes objects with at least this many keys
+#ifndef SOA_OBJ_INDEX_THRESHOLD
+#define SOA_OBJ_INDEX_THRESHOLD 16
+#endif
+
+// Thread pools keep up to this many bytes of freed buffers for reuse
+#ifndef SOA_POOL_MAX_BYTES
+#define SOA_POOL_MAX_BYTES (64 << 20)
+#endif
+
+// Buffers kept per size class, classes are powers of two from SOA_POOL_MIN
+#ifndef SOA_POOL_SLOTS
+#define SOA_POOL_SLOTS 4
+#endif
+
+#ifndef SOA_POOL_MIN
+#define SOA_POOL_MIN 4096
+#endif
+
 #include <stdint.h>
 #include <stddef.h>
 
 typedef struct {
-    char* msg;
-    int code;    
+    const char* msg; // static string, never freed
+    int code;
+    size_t offset; // byte offset of the failure in the input
 } soa_error_t;
 
+// Last error of the calling thread, calls that take a soa_error_t* leave it alone
 soa_error_t soa_error_get();
-void soa_error_push(char* msg, int code);
+void soa_error_set(soa_error_t error);
+void soa_error_push(const char* msg, int code);
 void soa_error_pop();
 
+// Sizes passed back are the ones asked for, a NULL allocator is malloc
+typedef struct {
+    void* (*alloc)(void* user, size_t size);
+    void* (*realloc)(void* user, void* ptr, size_t old_size, size_t size);
+    void  (*free)(void* user, void* ptr, size_t size);
+    void* user;
+} soa_allocator_t;
+
+void* _soa_alloc(const soa_allocator_t* alloc, size_t size);
+void* _soa_realloc(const soa_allocator_t* alloc, void* ptr, size_t old_size, size_t size);
+void  _soa_free(const soa_allocator_t* alloc, void* ptr, size_t size);
+
+// Recycles buffers through a pool owned by the calling thread, buffers can
+// be freed on any thread. Pools are emptied when their thread exits.
+const soa_allocator_t* soa_pool_allocator();
+// Frees what the calling thread's pool holds
+void soa_pool_trim();
+
 typedef enum {
     SOA_TYPE_BOOL = 0, // 0 = false, 1 = true, 2 = null
     SOA_TYPE_INT,
@@ -54,6 +94,8 @@ typedef enum {
     SOA_TYPE_SSO,
     SOA_TYPE_OBJ,
     SOA_TYPE_ARR,
+    SOA_TYPE_REF, // string borrowed from doc source
+    SOA_TYPE_F32, // single precision, held by packed arrays
 } soa_type_bit_t;
 typedef uint8_t soa_type_t; 
 
@@ -70,6 +112,9 @@ typedef struct {
     size_t cap;
     size_t root;
     soa_root_t root_type; 
+    const char* source; // not owned, borrowed strings point into it
+    size_t mapped; // size of the snapshot mapping data lives in, 0 when malloc'd
+    const soa_allocator_t* alloc; // of data, only changed while data is NULL or mapped
 } soa_doc_t;
 
 typedef enum {
@@ -79,27 +124,58 @@ typedef enum {
 } soa_bool_bit_t;
 typedef uint8_t soa_bool_t;
 
+// Strings know their length, embedded nulls are kept. Long strings in the
+// doc are a size_t length, the bytes and a null terminator, offsets point
+// at the bytes. Inline strings keep 7 - length in their last byte, which
+// is also the terminator of a 7 byte string.
+
+// Top bits of a long string's length, set by the parser when nothing in
+// the string needs escaping in JSON and when it is all ASCII
+#define _SOA_STR_CLEAN ((size_t)1 << (sizeof(size_t) * 8 - 1))
+#define _SOA_STR_ASCII ((size_t)1 << (sizeof(size_t) * 8 - 2))
+
+// Borrowed string, not null terminated
+typedef struct {
+    uint32_t offset;
+    uint32_t length;
+} soa_ref_t;
+
+typedef enum {
+    SOA_KEY_STR = 0,
+    SOA_KEY_SSO = 1,
+    SOA_KEY_REF = 2
+} soa_key_bit_t;
+
 typedef union {
     soa_bool_t b;
     int64_t i;
     uint64_t u;
     double f;
+    float f32;
     size_t s;
     char sso[8];
     size_t o;
     size_t a;
+    soa_ref_t r;
 } soa_valu_t; 
 
 typedef struct {
     soa_valu_t value;
     uint8_t type;
-    uint8_t sso;
+    uint8_t sso; // soa_key_bit_t
+    uint32_t hash; // soa_key_hash of the key, 0 if unknown
     union {
         size_t str; 
-        char sso[8];
+        char sso[8]; // zero filled, last byte is 7 - length
+        soa_ref_t ref;
     } key;
 } soa_obj_entry_t;
 
+typedef struct {
+    size_t length;
+    size_t index; // offset of the key index, 0 if not built
+} soa_obj_header_t;
+
 typedef struct {
     soa_valu_t value;
     uint8_t type;
@@ -108,6 +184,7 @@ typedef struct {
 typedef struct {
     soa_doc_t* doc;
     size_t data;
+    size_t tag; // offset of the type tag, 0 when it follows the value
 } soa_val_t;
 
 typedef struct {
@@ -127,37 +204,152 @@ soa_obj_t soa_doc_root_obj(soa_doc_t* doc);
 soa_arr_t soa_doc_root_arr(soa_doc_t* doc);
 
 uint8_t* _soa_doc_grow(soa_doc_t* doc, size_t size);
+
+// View of a whole file, data is NULL when it can't be mapped. Writable
+// maps are copy on write, changes never reach the file.
+typedef struct {
+    const char* data;
+    size_t size;
+} _soa_map_t;
+
+_soa_map_t _soa_map_file(const char* path, int writable);
+void _soa_unmap_file(_soa_map_t* map);
 soa_obj_t soa_doc_add_obj(soa_doc_t* doc, size_t element_count);
 soa_arr_t soa_doc_add_arr(soa_doc_t* doc, size_t element_count);
 size_t soa_doc_add_str(soa_doc_t* doc, const char* str);
+size_t soa_doc_add_str_n(soa_doc_t* doc, const char* str, size_t len);
+
+uint32_t  soa_key_hash(const char* key, size_t len);
 
+// Borrowed keys are copied into the doc first
 char*     soa_obj_key_at(soa_obj_t* obj, size_t index);
+// Never copies, result is not null terminated for borrowed keys
+const char* soa_obj_key_at_n(soa_obj_t* obj, size_t index, size_t* len);
 void      soa_obj_set_key_at(soa_obj_t* obj, size_t index, const char* key);
+void      soa_obj_set_key_at_n(soa_obj_t* obj, size_t index, const char* key, size_t len);
 size_t    soa_obj_length(soa_obj_t* obj);
 soa_val_t soa_obj_val_at_index(soa_obj_t* obj, size_t index);
 soa_val_t soa_obj_val_at_key(soa_obj_t* obj, const char* key);
 
+// Returns index of the first entry with the key or soa_obj_length when missing.
+// Never writes to the doc, objects are scanned unless they were indexed
+// with SOA_JSON_INDEX_KEYS or soa_obj_build_index / soa_doc_build_index.
+size_t    soa_obj_find_key(soa_obj_t* obj, const char* key, size_t len);
+// Same with the soa_key_hash of key already known
+size_t    _soa_obj_find_key_hash(soa_obj_t* obj, const char* key, size_t len, uint32_t hash);
+void      soa_obj_build_index(soa_obj_t* obj);
+void      soa_doc_build_index(soa_doc_t* doc);
+
 size_t    soa_arr_length(soa_arr_t* arr);
 soa_val_t soa_arr_val_at(soa_arr_t* arr, size_t index);
 
+// Containers laid out in columns keep their type tags, values and keys in
+// separate vectors, see SOA_COMPACT_COLUMNS. These give the packed tags and
+// values of one, NULL for the row layout. Valid until the doc grows.
+const uint8_t*    soa_arr_tags  (soa_arr_t* arr);
+const soa_valu_t* soa_arr_values(soa_arr_t* arr);
+const uint8_t*    soa_obj_tags  (soa_obj_t* obj);
+const soa_valu_t* soa_obj_values(soa_obj_t* obj);
+
+// Packed arrays hold numbers of one type back to back, see
+// SOA_COMPACT_PACKED. These give the numbers and write their count to len
+// when arr is packed with that type, NULL otherwise. Valid until the doc
+// grows.
+const int64_t*    soa_arr_ints  (soa_arr_t* arr, size_t* len);
+const uint64_t*   soa_arr_uints (soa_arr_t* arr, size_t* len);
+const double*     soa_arr_floats(soa_arr_t* arr, size_t* len);
+const float*      soa_arr_f32s  (soa_arr_t* arr, size_t* len);
+
 soa_type_t soa_val_type (const soa_val_t* val);
 soa_bool_t soa_val_bool (const soa_val_t* val);
 int64_t    soa_val_int  (const soa_val_t* val);
 uint64_t   soa_val_uint (const soa_val_t* val);
 double     soa_val_float(const soa_val_t* val);
-char*      soa_val_str  (const soa_val_t* val);
+char*      soa_val_str  (const soa_val_t* val); // copies borrowed strings into the doc
+const char* soa_val_str_n(const soa_val_t* val, size_t* len); // never copies
 soa_obj_t  soa_val_obj  (const soa_val_t* val);
 soa_arr_t  soa_val_arr  (const soa_val_t* val);
 
+// Setting a value of a packed array to another type moves the array back
+// to rows, values taken from it have to be taken again
 void soa_val_set_type (const soa_val_t* val, const soa_type_t type);
 void soa_val_set_bool (const soa_val_t* val, const soa_bool_t value);
 void soa_val_set_int  (const soa_val_t* val, const int64_t    value);
 void soa_val_set_uint (const soa_val_t* val, const uint64_t   value);
 void soa_val_set_float(const soa_val_t* val, const double     value);
+void soa_val_set_f32  (const soa_val_t* val, const float      value);
 void soa_val_set_str  (const soa_val_t* val, const char*      value);
+void soa_val_set_str_n(const soa_val_t* val, const char*      value, size_t len);
 void soa_val_set_obj  (const soa_val_t* val, const soa_obj_t* value);
 void soa_val_set_arr  (const soa_val_t* val, const soa_arr_t* value);
 
+// Containers grow in place when they end the doc and move to its end
+// with room to spare otherwise, reads through the parent find the new
+// place. Columns and packed arrays go back to rows on the first change.
+// The handle passed in follows, other handles to the container and values
+// taken from it have to be taken again. New entries are null.
+soa_val_t soa_arr_push  (soa_arr_t* arr);
+soa_val_t soa_arr_insert(soa_arr_t* arr, size_t index);
+void      soa_arr_erase (soa_arr_t* arr, size_t index);
+soa_val_t soa_obj_push  (soa_obj_t* obj, const char* key, size_t len);
+soa_val_t soa_obj_insert(soa_obj_t* obj, size_t index, const char* key, size_t len);
+void      soa_obj_erase (soa_obj_t* obj, size_t index);
+
+typedef enum {
+    SOA_COMPACT_DEPTH_FIRST = 0, // each container followed by its strings and key index, then its children
+    SOA_COMPACT_GROUPED = 1,     // arrays, objects, strings, key indexes, like the parser lays them out
+    SOA_COMPACT_COLUMNS = 2,     // containers in columns, rows otherwise
+    SOA_COMPACT_PACKED = 4,      // arrays of numbers of one type packed
+    SOA_COMPACT_F32 = 8          // with SOA_COMPACT_PACKED, arrays of floats packed as SOA_TYPE_F32
+} soa_compact_bit_t;
+typedef uint8_t soa_compact_t;
+
+// Rewrites what is reachable from the root into a buffer of its own,
+// returns the bytes reclaimed. Offsets taken before are no longer valid.
+// When memory runs out the doc is left as it was, 0 is returned and the
+// thread's last error is 42 "Out of memory!".
+// SOA_COMPACT_COLUMNS goes with either order and stores each container as
+// its values, then one type tag per entry, then the keys of objects, so
+// scans over types or numbers read packed memory.
+// SOA_COMPACT_PACKED stores arrays holding only integers or only floats as
+// a single type and the bare numbers, 8 bytes each, 4 with SOA_COMPACT_F32
+// which rounds them to single precision. Integers of mixed sign pack as
+// SOA_TYPE_INT when they all fit it.
+size_t    soa_doc_compact(soa_doc_t* doc, soa_compact_t layout);
+
+// Snapshots are the doc buffer behind a fixed header. Loading maps the
+// file and uses it as the doc, pages are only copied when written to and
+// the doc moves to the heap the first time it grows.
+
+#define SOA_SNAPSHOT_MAGIC "soadoc\r\n"
+// Bumped whenever the layout of entries changes
+#define SOA_SNAPSHOT_VERSION 2
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian; // 0x01020304 in the byte order of the writer
+    uint64_t size;
+    uint64_t root;
+    uint64_t checksum; // of the doc buffer
+    uint8_t root_type;
+    uint8_t word_size; // sizeof(size_t) of the writer
+    uint8_t reserved[22];
+} soa_snapshot_header_t;
+
+typedef enum {
+    SOA_SNAPSHOT_NONE = 0,
+    SOA_SNAPSHOT_CHECKSUM = 1, // reads the whole file
+    SOA_SNAPSHOT_VALIDATE = 2  // bounds checks every entry, for untrusted files
+} soa_snapshot_flag_bit_t;
+
+typedef uint32_t soa_snapshot_flags_t;
+
+// Copies borrowed strings into the doc and builds key indexes first, so
+// lookups on the loaded doc never write. Returns 0 on failure.
+int       soa_doc_save(soa_doc_t* doc, const char* path, soa_error_t* error);
+soa_doc_t soa_doc_load_mmap(const char* path, soa_snapshot_flags_t flags, soa_error_t* error);
+
 
 #ifdef __cplusplus
 } 
@@ -24,48 +24,64 @@ SOFTWARE.
 
 #pragma once
 
+#include <algorithm>
 #include <compare>
 #include <concepts>
 #include <cstring>
 #include <expected>
 #include <iterator>
+#include <memory_resource>
 #include <optional>
+#include <span>
 #include <string>
 #include <type_traits>
+#include <vector>
 #include <format>
 
 #include "soa.h"
+#include "soa_path.h"
 
 namespace soa{
 
 #define SOA_SERIALIZE_VAL(param) \
-template<::soa::serializer_mode m, typename ref_type, bool R> \
-constexpr static ::soa::error serializer(ref_type val_ref, const ::soa::base_val<R>& v) { \
+template<::soa::serializer_mode m, typename ref_type, typename V> \
+constexpr static ::soa::error serializer(ref_type val_ref, V& v) { \
 if constexpr (m == ::soa::serializer_mode::read) { auto _v = v.template as<decltype(val_ref.param)>(); \
 if(_v) { val_ref.param = _v.value();} else { return ::soa::err(_v.error()); } \
+} else if constexpr (m == ::soa::serializer_mode::read_json) { return v.read(val_ref.param); \
+} else if constexpr (m == ::soa::serializer_mode::write_json) { v.write(val_ref.param); \
 } else{ v.template write<decltype(val_ref.param)>(val_ref.param); }  return ::soa::error();}
 
 #define SOA_SERIALIZE_FIELD_BEGIN_ARR(element_count) \
-template<::soa::serializer_mode m, typename ref_type, bool R> \
-constexpr static ::soa::error serializer(ref_type val_ref, const ::soa::base_val<R>& v) { \
-::soa::arr arr; if constexpr (m == ::soa::serializer_mode::read) { auto arr_v = v.template as<::soa::arr>(); \
+template<::soa::serializer_mode m, typename ref_type, typename V> \
+constexpr static ::soa::error serializer(ref_type val_ref, V& v) { \
+::soa::arr arr; [[maybe_unused]] ::soa::serializer_json<m, V> json{v}; if constexpr (m == ::soa::serializer_mode::read) { auto arr_v = v.template as<::soa::arr>(); \
 if(arr_v) { arr = arr_v.value();} else { return ::soa::err(arr_v.error()); } \
 if(arr.size() < (element_count)) { return ::soa::err("invalid size", 1); } \
-} else{ arr = v.d->add_arr((element_count)); v.template write<::soa::arr>(arr); }
+} else if constexpr (m == ::soa::serializer_mode::read_json || m == ::soa::serializer_mode::write_json) { \
+if(auto e = json.begin(::soa::type::arr, (element_count))) { return e; } \
+} else{ arr = v.d->add_arr((element_count)); v.template write<::soa::arr>(arr); } \
+do { if constexpr (m == ::soa::serializer_mode::read_json) { if(auto e = json.next()) { return e; } }
 #define SOA_PLACEHOLDER_1 }
 
 #define SOA_ARR_FIELD(param, pos) \
 if constexpr (m == ::soa::serializer_mode::read) { auto val_v = arr.at(pos).template as<decltype(val_ref.param)>(); \
 if(val_v) {val_ref.param = val_v.value();} else {return ::soa::error(val_v.error());} \
+} else if constexpr (m == ::soa::serializer_mode::read_json) { if(json.pos_field(pos)) { \
+if(auto e = json.member.read(val_ref.param)) { return e; } continue; } \
+} else if constexpr (m == ::soa::serializer_mode::write_json) { if(json.pos_field(pos)) { v.write(val_ref.param); continue; } \
 } else{ arr.at(pos).template write<decltype(val_ref.param)>(val_ref.param); }
 
 #define SOA_SERIALIZE_FIELD_BEGIN_OBJ(req_count, element_count) \
-template<::soa::serializer_mode m, typename ref_type, bool R> \
-constexpr static ::soa::error serializer(ref_type val_ref, const ::soa::base_val<R>& v) { \
-::soa::obj obj; size_t obj_pos = 0; if constexpr (m == ::soa::serializer_mode::read) { auto obj_v = v.template as<::soa::obj>(); \
+template<::soa::serializer_mode m, typename ref_type, typename V> \
+constexpr static ::soa::error serializer(ref_type val_ref, V& v) { \
+::soa::obj obj; size_t obj_pos = 0; [[maybe_unused]] ::soa::serializer_json<m, V> json{v}; if constexpr (m == ::soa::serializer_mode::read) { auto obj_v = v.template as<::soa::obj>(); \
 if(obj_v) { obj = obj_v.value();} else { return ::soa::err(obj_v.error()); } \
 if(obj.size() < (req_count)) { return ::soa::err("invalid size", 1); } } \
-else{ obj = v.d->add_obj((element_count)); v.template write<::soa::obj>(obj); }
+else if constexpr (m == ::soa::serializer_mode::read_json || m == ::soa::serializer_mode::write_json) { \
+if(auto e = json.begin(::soa::type::obj, (req_count))) { return e; } } \
+else{ obj = v.d->add_obj((element_count)); v.template write<::soa::obj>(obj); } \
+do { if constexpr (m == ::soa::serializer_mode::read_json) { if(auto e = json.next()) { return e; } }
 #define SOA_PLACEHOLDER_2 }
 
 #define SOA_OBJ_FIELD(param, key) \
@@ -73,17 +89,24 @@ if constexpr (m == ::soa::serializer_mode::read) { \
 if (auto obj_pair = obj.at(key); obj_pair){ auto val_v = obj_pair.val().template as<decltype(val_ref.param)>(); \
 if(val_v) {val_ref.param = val_v.value();} else {return ::soa::error(val_v.error());} \
 } else{ return ::soa::error({"failed to find key: "#key, 4}); } \
+} else if constexpr (m == ::soa::serializer_mode::read_json) { auto f = json.key_field(key, true); \
+if(f == ::soa::field_match::hit) { if(auto e = json.member.read(val_ref.param)) { return e; } continue; } \
+else if(f == ::soa::field_match::missing) { return ::soa::error({"failed to find key: "#key, 4}); } \
+} else if constexpr (m == ::soa::serializer_mode::write_json) { v.write_key(key); v.write(val_ref.param); \
 } else{ auto obj_pair = obj.at(obj_pos++); obj_pair.set_key(key); obj_pair.val().template write<decltype(val_ref.param)>(val_ref.param); }
 
 #define SOA_OBJ_OPT_FIELD(param, key) \
 if constexpr (m == ::soa::serializer_mode::read) { \
 if (auto obj_pair = obj.at(key); obj_pair){ auto val_v = obj_pair.val().template as<decltype(val_ref.param)>(); \
 if(val_v) {val_ref.param = val_v.value();} else {return ::soa::error(val_v.error());} \
-}} else{ auto obj_pair = obj.at(obj_pos++); obj_pair.set_key(key); obj_pair.val().template write<decltype(val_ref.param)>(val_ref.param); }
+}} else if constexpr (m == ::soa::serializer_mode::read_json) { \
+if(json.key_field(key, false) == ::soa::field_match::hit) { if(auto e = json.member.read(val_ref.param)) { return e; } continue; } \
+} else if constexpr (m == ::soa::serializer_mode::write_json) { v.write_key(key); v.write(val_ref.param); \
+} else{ auto obj_pair = obj.at(obj_pos++); obj_pair.set_key(key); obj_pair.val().template write<decltype(val_ref.param)>(val_ref.param); }
 
 
 #define SOA_PLACEHOLDER_3 {
-#define SOA_SERIALIZE_FILED_END() return ::soa::error(); }
+#define SOA_SERIALIZE_FILED_END() } while(json.more()); return json.end(); }
 
 template<typename bits, std::underlying_type<bits>::type max>
 class flags{
@@ -168,9 +191,43 @@ struct str_buffer{
     }
 };
 
+// Adapts a std::pmr::memory_resource, both have to outlive the docs using it
+struct pmr_allocator {
+    soa_allocator_t a;
+
+    inline pmr_allocator(std::pmr::memory_resource* r = std::pmr::get_default_resource()) :a{
+        [](void* user, size_t size) -> void* {
+            return static_cast<std::pmr::memory_resource*>(user)->allocate(size ? size : 1);
+        },
+        [](void* user, void* ptr, size_t old_size, size_t size) -> void* {
+            auto r = static_cast<std::pmr::memory_resource*>(user);
+            void* n = r->allocate(size ? size : 1);
+            if(ptr){
+                std::memcpy(n, ptr, std::min(old_size, size));
+                r->deallocate(ptr, old_size ? old_size : 1);
+            }
+            return n;
+        },
+        [](void* user, void* ptr, size_t size){
+            if(ptr){
+                static_cast<std::pmr::memory_resource*>(user)->deallocate(ptr, size ? size : 1);
+            }
+        },
+        r
+    } {}
+    // docs keep a pointer to a
+    pmr_allocator(const pmr_allocator&) = delete;
+
+    inline operator const soa_allocator_t*() const {
+        return &a;
+    }
+};
+
+// msg points to static storage
 struct err{
-    string msg;
+    str msg;
     int code;
+    size_t offset = 0;
 };
 
 template<typename T>
@@ -192,7 +249,9 @@ enum class type : uint8_t {
     str,
     sso,
     obj,
-    arr
+    arr,
+    ref,
+    f32
 };
 
 template<bool is_root = false>
@@ -240,6 +299,23 @@ struct obj {
     pair operator[](const size_t pos);
     pair operator[](const str key);
 
+    // New values are null, the object may move, see soa_obj_push
+    pair push_back(const str key);
+    template<typename T>
+    pair push_back(const str key, const T& value);
+    pair emplace(const size_t pos, const str key);
+    void erase(const size_t pos);
+
+    // Packed tags and values in the column layout, empty for rows
+    inline std::span<const uint8_t> tags(){
+        const uint8_t* t = soa_obj_tags(&o);
+        return t ? std::span(t, size()) : std::span<const uint8_t>();
+    }
+    inline std::span<const soa_valu_t> values(){
+        const soa_valu_t* v = soa_obj_values(&o);
+        return v ? std::span(v, size()) : std::span<const soa_valu_t>();
+    }
+
 
 };
 
@@ -275,6 +351,36 @@ struct arr{
 
     val at(const size_t pos);
     val operator[](const size_t pos);
+
+    // New values are null, the array may move, see soa_arr_push
+    val push_back();
+    template<typename T>
+    val push_back(const T& value);
+    val emplace(const size_t pos);
+    void erase(const size_t pos);
+
+    // Packed tags and values in the column layout, empty for rows
+    inline std::span<const uint8_t> tags(){
+        const uint8_t* t = soa_arr_tags(&a);
+        return t ? std::span(t, size()) : std::span<const uint8_t>();
+    }
+    inline std::span<const soa_valu_t> values(){
+        const soa_valu_t* v = soa_arr_values(&a);
+        return v ? std::span(v, size()) : std::span<const soa_valu_t>();
+    }
+
+    // Numbers of an array packed as T, empty otherwise, see SOA_COMPACT_PACKED
+    template<typename T>
+    requires std::same_as<T, i64> || std::same_as<T, u64> || std::same_as<T, f64> || std::same_as<T, float>
+    inline std::span<const T> numbers(){
+        size_t n = 0;
+        const T* p;
+        if constexpr (std::same_as<T, i64>) p = soa_arr_ints(&a, &n);
+        else if constexpr (std::same_as<T, u64>) p = soa_arr_uints(&a, &n);
+        else if constexpr (std::same_as<T, f64>) p = soa_arr_floats(&a, &n);
+        else p = soa_arr_f32s(&a, &n);
+        return p ? std::span(p, n) : std::span<const T>();
+    }
 };
 
 struct doc {
@@ -284,37 +390,28 @@ struct doc {
     inline doc() {
         d = soa_doc_new();
     }
+    // Memory comes from alloc, which has to outlive the doc
+    inline doc(const soa_allocator_t* alloc) {
+        d = soa_doc_new();
+        d.alloc = alloc;
+    }
 
-    constexpr doc(const doc&) = delete; // TODO: copy and move constructor
+    constexpr doc(const doc&) = delete; // TODO: copy constructor
     
-    inline constexpr doc(doc&& other) {
-        d.size = other.d.size;
-        d.cap = other.d.cap;
-        d.data = other.d.data;
-        d.root = other.d.root;
-        d.root_type = other.d.root_type;
-        d.size = 0;
-        d.cap =  0;
-        d.data = 0;
-        d.root = 0;
-        d.root_type = 0;
+    inline constexpr doc(doc&& other) :d(other.d) {
+        other.d = soa_doc_t{};
     };
 
     inline ~doc() {
         soa_doc_free(&d);
     }
 
-    inline constexpr doc& operator=(doc&& other){
-        d.size = other.d.size;
-        d.cap = other.d.cap;
-        d.data = other.d.data;
-        d.root = other.d.root;
-        d.root_type = other.d.root_type;
-        d.size = 0;
-        d.cap =  0;
-        d.data = 0;
-        d.root = 0;
-        d.root_type = 0;
+    inline doc& operator=(doc&& other){
+        if(this != &other){
+            soa_doc_free(&d);
+            d = other.d;
+            other.d = soa_doc_t{};
+        }
         return *this;
     }
 
@@ -330,13 +427,194 @@ struct doc {
         return {soa_doc_add_arr(&d, length), this};
     }
     inline size_t add_str(const str str){
-        return soa_doc_add_str(&d, str.data());
+        return soa_doc_add_str_n(&d, str.data(), str.size());
+    }
+
+    enum class layout : uint8_t {
+        depth_first = SOA_COMPACT_DEPTH_FIRST,
+        grouped = SOA_COMPACT_GROUPED
+    };
+
+    // Drops what is no longer reachable, returns bytes reclaimed. Handles
+    // into the doc have to be taken again.
+    enum class shape_bits : uint8_t {
+        rows = 0,
+        columns = SOA_COMPACT_COLUMNS,
+        packed = SOA_COMPACT_PACKED,
+        packed_f32 = SOA_COMPACT_PACKED | SOA_COMPACT_F32
+    };
+    using shape = flags<shape_bits,
+        (size_t)shape_bits::columns | (size_t)shape_bits::packed_f32
+    >;
+
+    // Columns keep values, tags and keys of containers apart, packed
+    // arrays of numbers hold only the numbers, see soa_doc_compact
+    inline size_t compact(layout l = layout::depth_first, shape s = {}){
+        return soa_doc_compact(&d, static_cast<soa_compact_t>(l) | static_cast<soa_compact_t>(s));
+    }
+
+    // Snapshot of the doc, see soa_doc_save
+    inline error save(const string& path){
+        soa_error_t e;
+        if(!soa_doc_save(&d, path.c_str(), &e)){
+            return err{e.msg, e.code, e.offset};
+        }
+        return std::nullopt;
     }
 };
 
+enum class snapshot_flag_bits : uint32_t {
+    none = 0,
+    checksum = 1,
+    validate = 2
+};
+using snapshot_flags = flags<snapshot_flag_bits,
+    (size_t)snapshot_flag_bits::checksum | (size_t)snapshot_flag_bits::validate
+>;
+
+// Maps a snapshot written by doc::save, validate for untrusted files
+inline static auto load_snapshot(const string& path, snapshot_flags flags = {})-> result<doc>{
+    soa_error_t e;
+    soa_doc_t d = soa_doc_load_mmap(path.c_str(), static_cast<soa_snapshot_flags_t>(flags), &e);
+    if(e.code){
+        return result_error(err{e.msg, e.code, e.offset});
+    }
+    return d;
+}
+
 enum class serializer_mode{
     read,
-    write
+    write,
+    read_json,
+    write_json
+};
+
+// Reading straight from json text. The members are read in one pass and
+// each is offered to the fields in the order they are declared, the ones
+// no field takes are skipped. After the last member the fields are asked
+// once more to report required ones that were not found.
+enum class field_match{
+    skip,
+    hit,
+    missing
+};
+
+template<serializer_mode m, typename V>
+struct serializer_json{
+    inline constexpr serializer_json(const V&) {}
+    inline constexpr bool more() const { return false; }
+    inline constexpr error end() const { return std::nullopt; }
+};
+
+// V is the cursor json::ondemand hands in
+template<typename V>
+struct serializer_json<serializer_mode::read_json, V>{
+    V container;
+    V member;
+    str key;
+    string key_buf;
+    uint64_t seen = 0; // fields found, the first 64
+    std::vector<bool> seen_more; // and past them, only wide types allocate
+    size_t field = 0;
+    size_t size = 0;
+    size_t min_size = 0;
+    bool done = false;
+
+    inline serializer_json(V& v) :container(v), member(v) {}
+
+    inline error begin(type t, size_t min){
+        min_size = min;
+        auto found = container.type();
+        if(!found) return found.error();
+        if(*found != t) return err{t == type::obj ? "value is not an object" : "value is not an array", 3};
+        return std::nullopt;
+    }
+
+    inline error next(){
+        field = 0;
+        if(!container.next(member, key, key_buf)){
+            done = true;
+            if(auto e = container.last_error()) return e;
+            if(size < min_size) return err{"invalid size", 1};
+            return std::nullopt;
+        }
+        size++;
+        return std::nullopt;
+    }
+
+    inline bool more() const {
+        return !done;
+    }
+
+    inline bool found(size_t f) const {
+        if(f < 64) return seen >> f & 1;
+        return f - 64 < seen_more.size() && seen_more[f - 64];
+    }
+
+    inline void mark(size_t f){
+        if(f < 64){
+            seen |= uint64_t(1) << f;
+            return;
+        }
+        if(seen_more.size() <= f - 64) seen_more.resize(f - 63);
+        seen_more[f - 64] = true;
+    }
+
+    inline field_match key_field(const str k, bool required){
+        size_t f = field++;
+        if(done) return required && !found(f) ? field_match::missing : field_match::skip;
+        if(key != k) return field_match::skip;
+        mark(f);
+        return field_match::hit;
+    }
+
+    inline bool pos_field(size_t pos) const {
+        return !done && size - 1 == pos;
+    }
+
+    inline constexpr error end() const {
+        return std::nullopt;
+    }
+};
+
+// Writing straight to json text, V is json::writer. Arrays are written
+// one position per pass over the fields so they can be declared in any
+// order, positions no field takes print as null like the unset values of
+// a doc.
+template<typename V>
+struct serializer_json<serializer_mode::write_json, V>{
+    V& out;
+    type t = type::obj;
+    size_t pos = 0;
+    size_t size = 0;
+    bool written = false;
+
+    inline serializer_json(V& v) :out(v) {}
+
+    inline error begin(type t, size_t size){
+        this->t = t;
+        this->size = size;
+        out.begin(t);
+        return std::nullopt;
+    }
+
+    inline bool pos_field(size_t p){
+        if(written || p != pos || pos >= size) return false;
+        written = true;
+        return true;
+    }
+
+    inline bool more(){
+        if(t != type::arr) return false;
+        if(pos < size && !written) out.null();
+        written = false;
+        return ++pos < size;
+    }
+
+    inline error end(){
+        out.end(t);
+        return std::nullopt;
+    }
 };
 
 template<typename T, bool R>
@@ -433,9 +711,10 @@ struct base_val {
     template<>
     inline result<str> as() const{
         if constexpr (is_root) return result_error({"value is root", 5});
-        char* str = soa_val_str(&v);
+        size_t len;
+        const char* str = soa_val_str_n(&v, &len);
         if(!str){ return result_error({"value is not a string", 3}); }
-        return str;
+        return ::soa::str{str, len};
     }
 
     template<>
@@ -485,7 +764,7 @@ struct base_val {
     template<> inline void write(const f64 val) const { if constexpr (!is_root) soa_val_set_float(&v, val); }
     template<> inline void write(const float val) const { if constexpr (!is_root) write<f64>(static_cast<f64>(val)); }
 
-    template<> inline void write(const str val) const { if constexpr (!is_root) soa_val_set_str(&v, val.data()); }
+    template<> inline void write(const str val) const { if constexpr (!is_root) soa_val_set_str_n(&v, val.data(), val.size()); }
     template<> inline void write(const obj val) const { 
         if constexpr (is_root){
             set_type(soa::type::obj);
@@ -530,11 +809,13 @@ struct obj::pair{
     }
 
     inline constexpr str key() {
-        return soa_obj_key_at(&o->o, index);
+        size_t len;
+        const char* key = soa_obj_key_at_n(&o->o, index, &len);
+        return {key, len};
     }
 
     inline void set_key(str str){
-        soa_obj_set_key_at(&o->o, index, str.data());
+        soa_obj_set_key_at_n(&o->o, index, str.data(), str.size());
     }
 
     inline constexpr operator bool(){
@@ -551,13 +832,9 @@ inline obj::pair obj::at(const size_t pos){
 }
 
 inline obj::pair obj::at(const str key){
-    for (size_t i = 0; i < size(); i++) {
-        auto pair = at(i);
-        if(pair.key() == key){
-            return pair;
-        }
-    }
-    return {this, size()};
+    size_t pos = soa_obj_find_key(&o, key.data(), key.size());
+    if(pos >= size()) return {this, size()};
+    return at(pos);
 }
 
 inline obj::pair obj::operator[](const size_t pos){
@@ -577,6 +854,112 @@ inline val arr::operator[](const size_t pos){
     return at(pos);
 }
 
+inline obj::pair obj::push_back(const str key){
+    size_t pos = size();
+    return {this, {soa_obj_push(&o, key.data(), key.size()), d}, pos};
+}
+
+template<typename T>
+inline obj::pair obj::push_back(const str key, const T& value){
+    pair p = push_back(key);
+    p.val().template write<T>(value);
+    return p;
+}
+
+inline obj::pair obj::emplace(const size_t pos, const str key){
+    if(pos > size()) return {this, size()};
+    return {this, {soa_obj_insert(&o, pos, key.data(), key.size()), d}, pos};
+}
+
+inline void obj::erase(const size_t pos){
+    soa_obj_erase(&o, pos);
+}
+
+inline val arr::push_back(){
+    return {soa_arr_push(&a), d};
+}
+
+template<typename T>
+inline val arr::push_back(const T& value){
+    val v = push_back();
+    v.template write<T>(value);
+    return v;
+}
+
+inline val arr::emplace(const size_t pos){
+    if(pos > size()) return {};
+    return {soa_arr_insert(&a, pos), d};
+}
+
+inline void arr::erase(const size_t pos){
+    soa_arr_erase(&a, pos);
+}
+
+// Compiled JSON Pointer or dotted path, see soa_path_new. Compile the
+// paths used on every document once and keep them, evaluating one does
+// no parsing and no allocation.
+struct path{
+    soa_path_t* p = nullptr;
+
+    constexpr path() = default;
+    inline constexpr path(soa_path_t* p) :p(p) {}
+
+    path(const path&) = delete;
+    inline constexpr path(path&& other) :p(other.p) {
+        other.p = nullptr;
+    }
+
+    inline ~path() {
+        soa_path_free(p);
+    }
+
+    inline path& operator=(path&& other){
+        if(this != &other){
+            soa_path_free(p);
+            p = other.p;
+            other.p = nullptr;
+        }
+        return *this;
+    }
+
+    inline constexpr operator bool() const { return p; }
+
+    inline static auto compile(const str s)-> result<path>{
+        soa_error_t e;
+        soa_path_t* p = soa_path_new(s.data(), s.size(), &e);
+        if(!p){
+            return result_error(err{e.msg, e.code, e.offset});
+        }
+        return path{p};
+    }
+
+    // First match in document order, empty when nothing matches
+    inline val get(doc& d) const {
+        soa_val_t v;
+        if(!soa_path_get(p, &d.d, &v)){
+            return {};
+        }
+        return {v, &d};
+    }
+
+    // Calls fn with every match in document order until it returns false,
+    // fn may also return nothing. Returns matches delivered.
+    template<typename F>
+    inline size_t each(doc& d, F&& fn) const {
+        struct ctx { F& fn; doc* d; } c{fn, &d};
+        return soa_path_each(p, &d.d, [](void* user, soa_val_t* v) -> int {
+            ctx& c = *static_cast<ctx*>(user);
+            if constexpr (std::is_void_v<std::invoke_result_t<F&, val>>){
+                c.fn(val{*v, c.d});
+                return 0;
+            }
+            else{
+                return !c.fn(val{*v, c.d});
+            }
+        }, &c);
+    }
+};
+
 template<int step, typename cont, typename value>
 class step_iterator{
 public:
@@ -756,6 +1139,7 @@ struct std::formatter<soa::type> {
         case soa::type::u64:
             return std::format_to(ctx.out(), "uint");
         case soa::type::f64:
+        case soa::type::f32:
             return std::format_to(ctx.out(), "float");
         case soa::type::str:
         case soa::type::sso:
@@ -786,6 +1170,8 @@ struct std::formatter<soa::val> {
             return std::format_to(ctx.out(),  "{}", obj.as<soa::u64>().value());
         case soa::type::f64:
             return std::format_to(ctx.out(),  "{}", obj.as<soa::f64>().value());
+        case soa::type::f32:
+            return std::format_to(ctx.out(),  "{}", obj.as<float>().value());
         case soa::type::str:
         case soa::type::sso:
             return std::format_to(ctx.out(),  "{}", obj.as<soa::str>().value());
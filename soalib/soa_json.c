@@ -26,51 +26,104 @@ SOFTWARE.
 
 #include "soalib/soa.h"
 
+#include <float.h>
 #include <limits.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
+#include <threads.h>
 
-#ifdef _WIN64
-#define SOA_LD_FORMAT "%lld"
-#define SOA_LU_FORMAT "%llu"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#ifdef _WIN32
+#include <io.h>
 #else
-#define SOA_LD_FORMAT "%ld"
-#define SOA_LU_FORMAT "%lu"
+#include <unistd.h>
 #endif
 
 typedef struct {
     char* str;
+    size_t size;
     size_t cap;
+    size_t total;
+    soa_json_sink_t sink;
+    uint8_t failed;
+    const soa_allocator_t* alloc;
 } _soa_str_t;
 
-_soa_str_t _soa_str_new(size_t size) {
+static _soa_str_t _soa_str_new(size_t size, const soa_allocator_t* alloc) {
     return (_soa_str_t){
         .cap = size,
-        .str = calloc(size, sizeof(char))
+        .str = _soa_alloc(alloc, size),
+        .alloc = alloc
     };
 }
 
-char* _soa_str_add_size(_soa_str_t* str, size_t size){
-    if(strlen(str->str) + size >= str->cap){
-        str->cap += size;
-        str->cap *= 2;
-        str->str = realloc(str->str, str->cap);
-    } 
-    return str->str + strlen(str->str);
+// Buffer flushed to sink when full, memory is owned by caller
+static _soa_str_t _soa_str_new_sink(soa_json_sink_t sink, char* buffer, size_t size) {
+    return (_soa_str_t){
+        .cap = size,
+        .str = buffer,
+        .sink = sink
+    };
+}
+
+static void _soa_str_flush(_soa_str_t* str){
+    if(!str->size) return;
+    if(!str->failed){
+        size_t written = str->sink.write(str->sink.user, str->str, str->size);
+        str->total += written;
+        if(written < str->size){
+            // sink is full or broken, drop everything after this point
+            str->failed = 1;
+        }
+    }
+    str->size = 0;
 }
 
-void _soa_str_add(_soa_str_t* str, char* new){
-    _soa_str_add_size(str, strlen(new));
-    strcat(str->str, new);
-    // printf("%s\n", str->str);
+// Returns pointer to exactly size writable bytes at the end of the buffer,
+// in sink mode size has to be smaller than the sink buffer
+static char* _soa_str_add_size(_soa_str_t* str, size_t size){
+    if(str->size + size >= str->cap){
+        if(str->sink.write){
+            _soa_str_flush(str);
+        }
+        else{
+            size_t cap = (str->size + size) * 2;
+            str->str = _soa_realloc(str->alloc, str->str, str->cap, cap);
+            str->cap = cap;
+        }
+    } 
+    char* ptr = str->str + str->size;
+    str->size += size;
+    return ptr;
+}
 
+static inline void _soa_str_add(_soa_str_t* str, const char* new, size_t size){
+    if(str->sink.write && str->size + size >= str->cap){
+        _soa_str_flush(str);
+        if(size >= str->cap){
+            // too big for the buffer, pass straight to the sink
+            if(!str->failed){
+                size_t written = str->sink.write(str->sink.user, new, size);
+                str->total += written;
+                str->failed = written < size;
+            }
+            return;
+        }
+    }
+    memcpy(_soa_str_add_size(str, size), new, size);
 }
 
-void _soa_str_free(_soa_str_t* str){
-    free(str->str);
+#define _soa_str_lit(str, lit) _soa_str_add(str, lit, sizeof(lit) - 1)
+
+// Gives back the unused tail of the last _soa_str_add_size
+inline static void _soa_str_unadd(_soa_str_t* str, size_t size){
+    str->size -= size;
 }
 
 typedef struct {
@@ -87,6 +140,7 @@ typedef struct {
     size_t str;
     size_t str_size;
     soa_root_t root_type;
+    const soa_allocator_t* alloc;
 } _json_info_t;
 
 typedef struct {
@@ -99,14 +153,14 @@ typedef struct {
     uint8_t* ptr;
 } _json_read_info_t;
 
-static _json_info_t _info_new(size_t prealloc){
-    _json_info_t i = {0};
+static _json_info_t _info_new(size_t prealloc, const soa_allocator_t* alloc){
+    _json_info_t i = {.alloc = alloc};
 
     i.acap = prealloc;
-    i.asizes = malloc(prealloc * sizeof(size_t));
+    i.asizes = _soa_alloc(alloc, prealloc * sizeof(size_t));
 
     i.ocap = prealloc;
-    i.osizes = malloc(prealloc * sizeof(size_t));
+    i.osizes = _soa_alloc(alloc, prealloc * sizeof(size_t));
 
     return i;
 }
@@ -114,8 +168,8 @@ static _json_info_t _info_new(size_t prealloc){
 inline static size_t _info_add_obj(_json_info_t* i){
     i->oo++;
     if(i->oo > i->ocap){
+        i->osizes = _soa_realloc(i->alloc, i->osizes, i->ocap * sizeof(size_t), i->oo * 2 * sizeof(size_t));
         i->ocap = i->oo * 2;
-        i->osizes = realloc(i->osizes, i->ocap * sizeof(size_t));
     }
     return i->oo - 1;
 }
@@ -123,17 +177,17 @@ inline static size_t _info_add_obj(_json_info_t* i){
 inline static size_t _info_add_arr(_json_info_t* i){
     i->ao++;
     if(i->ao > i->acap){
+        i->asizes = _soa_realloc(i->alloc, i->asizes, i->acap * sizeof(size_t), i->ao * 2 * sizeof(size_t));
         i->acap = i->ao * 2;
-        i->asizes = realloc(i->asizes, i->acap * sizeof(size_t));
     }
     return i->ao - 1;
 } 
 
 inline static void _info_free(_json_info_t* i){
     if(i->asizes)
-        free(i->asizes);
+        _soa_free(i->alloc, i->asizes, i->acap * sizeof(size_t));
     if(i->osizes)
-        free(i->osizes);
+        _soa_free(i->alloc, i->osizes, i->ocap * sizeof(size_t));
 }
 
 inline static int _is_digit(char c){
@@ -151,45 +205,884 @@ inline static int _is_ws_char(char c){
     return 0;
 }
 
-inline static const char* _skip_ws(const char* ptr){
-    while(*ptr && _is_ws_char(*ptr)){
+// Structural index
+//
+// Input is classified in 64 byte blocks into quote, backslash, whitespace and
+// operator ({}[]:,) bitmasks. Escapes and string interiors are resolved with
+// carries between blocks, what is left are positions of operators, of both
+// quotes of every string and of the first character of every scalar. Both
+// parser passes walk these positions instead of the raw text.
+
+typedef struct {
+    uint64_t quote;
+    uint64_t bs;
+    uint64_t ws;
+    uint64_t op;
+} _json_block_t;
+
+typedef void (*_json_classify_fn)(const uint8_t* in, _json_block_t* b);
+
+typedef struct {
+    const char* json;
+    size_t len;
+    uint32_t* pos;
+    size_t count;
+    size_t cap;
+    size_t t;
+    soa_json_parse_flags_t flags;
+    soa_error_t error;
+
+    // carried between blocks, lets the push parser index as input arrives
+    size_t indexed;
+    uint64_t prev_escaped;
+    uint64_t prev_in_string;
+    uint64_t prev_scalar;
+    int more; // input is not complete, the builder waits for tokens
+    const soa_allocator_t* alloc;
+} _json_index_t;
+
+#if !defined(SOA_JSON_NO_SIMD) && (defined(__x86_64__) || defined(_M_X64))
+#define SOA_JSON_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SOA_TARGET(t)
+#else
+#define SOA_TARGET(t) __attribute__((target(t)))
+#endif
+#endif
+
+inline static int _ctz64(uint64_t v){
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanForward64(&i, v);
+    return (int)i;
+#else
+    return __builtin_ctzll(v);
+#endif
+}
+
+inline static uint64_t _prefix_xor(uint64_t v){
+    v ^= v << 1;
+    v ^= v << 2;
+    v ^= v << 4;
+    v ^= v << 8;
+    v ^= v << 16;
+    v ^= v << 32;
+    return v;
+}
+
+inline static int _popcount64(uint64_t v){
+#ifdef _MSC_VER
+    return (int)__popcnt64(v);
+#else
+    return __builtin_popcountll(v);
+#endif
+}
+
+// Characters preceded by an odd number of backslashes, prev carries the
+// escape of the first character of the next block
+inline static uint64_t _escaped(uint64_t bs, uint64_t* prev){
+    const uint64_t even_bits = 0x5555555555555555ull;
+    if(!bs){
+        uint64_t escaped = *prev;
+        *prev = 0;
+        return escaped;
+    }
+    bs &= ~*prev;
+    uint64_t follows_escape = bs << 1 | *prev;
+    uint64_t odd_starts = bs & ~even_bits & ~follows_escape;
+    uint64_t even_starts = odd_starts + bs;
+    *prev = even_starts < odd_starts;
+    return (even_bits ^ (even_starts << 1)) & follows_escape;
+}
+
+#ifndef SOA_JSON_X86
+static void _classify_scalar(const uint8_t* in, _json_block_t* b){
+    *b = (_json_block_t){0};
+    for (int i = 0; i < 64; i++) {
+        uint64_t bit = 1ull << i;
+        switch(in[i]){
+            case '"':
+                b->quote |= bit;
+                break;
+            case '\\':
+                b->bs |= bit;
+                break;
+            case ' ': case '\t': case '\n': case '\r':
+                b->ws |= bit;
+                break;
+            case '{': case '}': case '[': case ']': case ':': case ',':
+                b->op |= bit;
+                break;
+        }
+    }
+}
+#else
+// '[' | 0x20 == '{' and ']' | 0x20 == '}', saves two compares per vector
+SOA_TARGET("sse2")
+static void _classify_sse2(const uint8_t* in, _json_block_t* b){
+    *b = (_json_block_t){0};
+    for (int i = 0; i < 4; i++) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(in + i * 16));
+        __m128i l = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        __m128i ws = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')))
+        );
+        __m128i op = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(l, _mm_set1_epi8('{')), _mm_cmpeq_epi8(l, _mm_set1_epi8('}'))),
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(':')), _mm_cmpeq_epi8(v, _mm_set1_epi8(',')))
+        );
+        b->quote |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('"'))) << (i * 16);
+        b->bs    |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))) << (i * 16);
+        b->ws    |= (uint64_t)(uint16_t)_mm_movemask_epi8(ws) << (i * 16);
+        b->op    |= (uint64_t)(uint16_t)_mm_movemask_epi8(op) << (i * 16);
+    }
+}
+
+SOA_TARGET("avx2")
+static void _classify_avx2(const uint8_t* in, _json_block_t* b){
+    *b = (_json_block_t){0};
+    for (int i = 0; i < 2; i++) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(in + i * 32));
+        __m256i l = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        __m256i ws = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')))
+        );
+        __m256i op = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(l, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(l, _mm256_set1_epi8('}'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(':')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8(',')))
+        );
+        b->quote |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"'))) << (i * 32);
+        b->bs    |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))) << (i * 32);
+        b->ws    |= (uint64_t)(uint32_t)_mm256_movemask_epi8(ws) << (i * 32);
+        b->op    |= (uint64_t)(uint32_t)_mm256_movemask_epi8(op) << (i * 32);
+    }
+}
+
+SOA_TARGET("avx512f,avx512bw")
+static void _classify_avx512(const uint8_t* in, _json_block_t* b){
+    __m512i v = _mm512_loadu_si512((const void*)in);
+    __m512i l = _mm512_or_si512(v, _mm512_set1_epi8(0x20));
+    b->quote = _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('"'));
+    b->bs    = _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('\\'));
+    b->ws    = _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8(' '))  | _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('\t')) |
+               _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('\n')) | _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('\r'));
+    b->op    = _mm512_cmpeq_epi8_mask(l, _mm512_set1_epi8('{'))  | _mm512_cmpeq_epi8_mask(l, _mm512_set1_epi8('}')) |
+               _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8(':'))  | _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8(','));
+}
+#endif
+
+static _json_classify_fn _classify_select(){
+#ifdef SOA_JSON_X86
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if(info[0] >= 7){
+        __cpuid(info, 1);
+        uint64_t xcr0 = (info[2] >> 27) & 1 ? _xgetbv(0) : 0;
+        __cpuidex(info, 7, 0);
+        if((xcr0 & 0xE6) == 0xE6 && (info[1] & (1 << 16)) && (info[1] & (1 << 30))){
+            return _classify_avx512;
+        }
+        if((xcr0 & 0x6) == 0x6 && (info[1] & (1 << 5))){
+            return _classify_avx2;
+        }
+    }
+#else
+    if(__builtin_cpu_supports("avx512bw")){
+        return _classify_avx512;
+    }
+    if(__builtin_cpu_supports("avx2")){
+        return _classify_avx2;
+    }
+#endif
+    return _classify_sse2;
+#else
+    return _classify_scalar;
+#endif
+}
+
+// CPU features don't change while running, checked on the first parse only
+static once_flag s_classify_once = ONCE_FLAG_INIT;
+static _json_classify_fn s_classify;
+
+static void _classify_init(void){
+    s_classify = _classify_select();
+}
+
+// Errors stay on the parse until it returns, a later one overwrites an earlier one
+inline static int _json_error(_json_index_t* x, const char* msg, int code, size_t offset){
+    x->error = (soa_error_t){msg, code, offset};
+    return 0;
+}
+
+static void _index_reserve(_json_index_t* x, size_t size){
+    if(size > x->cap){
+        x->pos = _soa_realloc(x->alloc, x->pos, x->cap * sizeof(uint32_t), size * 2 * sizeof(uint32_t));
+        x->cap = size * 2;
+    }
+}
+
+inline static void _index_free(_json_index_t* x){
+    if(x->pos)
+        _soa_free(x->alloc, x->pos, x->cap * sizeof(uint32_t));
+}
+
+// Indexes json[x->indexed..end), a block short of 64 bytes is padded with
+// spaces so it has to be the end of input
+static void _index_blocks(_json_index_t* x, size_t end){
+    const char* json = x->json;
+    call_once(&s_classify_once, _classify_init);
+    _json_classify_fn classify = s_classify;
+    uint64_t prev_escaped = x->prev_escaped;
+    uint64_t prev_in_string = x->prev_in_string;
+    uint64_t prev_scalar = x->prev_scalar;
+
+    for (size_t base = x->indexed; base < end; base += 64) {
+        const uint8_t* in = (const uint8_t*)json + base;
+        uint8_t tail[64];
+        if(end - base < 64){
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, in, end - base);
+            in = tail;
+        }
+
+        _json_block_t b;
+        classify(in, &b);
+
+        uint64_t escaped = _escaped(b.bs, &prev_escaped);
+        uint64_t quote = b.quote & ~escaped;
+        uint64_t in_string = _prefix_xor(quote) ^ prev_in_string;
+        prev_in_string = (uint64_t)((int64_t)in_string >> 63);
+        uint64_t string_tail = in_string ^ quote;
+
+        uint64_t scalar = ~(b.op | b.ws);
+        uint64_t nonquote_scalar = scalar & ~quote;
+        uint64_t follows_scalar = nonquote_scalar << 1 | prev_scalar;
+        prev_scalar = nonquote_scalar >> 63;
+
+        uint64_t structural = ((b.op | (scalar & ~follows_scalar)) & ~string_tail) | quote;
+        if(end - base < 64){
+            structural &= (1ull << (end - base)) - 1;
+        }
+
+        _index_reserve(x, x->count + 64);
+        while(structural){
+            x->pos[x->count++] = (uint32_t)(base + _ctz64(structural));
+            structural &= structural - 1;
+        }
+    }
+
+    x->indexed = end > x->indexed ? end : x->indexed;
+    x->prev_escaped = prev_escaped;
+    x->prev_in_string = prev_in_string;
+    x->prev_scalar = prev_scalar;
+}
+
+// sentinel, lets scalars find their end without a bounds check
+inline static void _index_end(_json_index_t* x){
+    _index_reserve(x, x->count + 1);
+    x->pos[x->count++] = (uint32_t)x->len;
+    x->more = 0;
+}
+
+static int _index_build(_json_index_t* x, const char* json, size_t len){
+    if(len >= UINT32_MAX){
+        return _json_error(x, "Document too large!", 41, 0);
+    }
+    x->json = json;
+    x->len = len;
+    x->count = 0;
+    x->t = 0;
+    x->indexed = 0;
+    x->prev_escaped = 0;
+    x->prev_in_string = 0;
+    x->prev_scalar = 0;
+
+    _index_blocks(x, len);
+    _index_end(x);
+    return 1;
+}
+
+// Character at the current token, 0 at the end of input
+inline static char _tok(const _json_index_t* x){
+    uint32_t p = x->pos[x->t];
+    return p < x->len ? x->json[p] : 0;
+}
+
+inline static size_t _tok_pos(const _json_index_t* x){
+    return x->pos[x->t];
+}
+
+static int _parse_val(_json_index_t* x, _json_info_t* i);
+static void _read_val(_json_index_t* x, _json_info_t* i, _json_read_info_t* r);
+
+// Number decoder
+//
+// Numbers are scanned and converted in one go. Digits are accumulated into
+// a 64-bit mantissa, eight at a time where the input allows. Integers are
+// exact and overflow is detected from the digit count. Doubles take the
+// exact fast path when both mantissa and power of ten fit a double,
+// otherwise Eisel-Lemire rounds them correctly using the 128-bit powers of
+// ten below. What it cannot decide, and mantissas over 19 digits, go
+// through strtod.
+
+#if defined(_WIN32) || (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define SOA_JSON_SWAR
+#endif
+
+#define SOA_POW10_MIN -348
+#define SOA_POW10_MAX 347
+
+// 10^e normalized to 128 bits and truncated, as {low, high}
+static const uint64_t _pow10_128[][2] = {
+    {0x1732C869CD60E453, 0xFA8FD5A0081C0288}, {0x0E7FBD42205C8EB4, 0x9C99E58405118195},
+    {0x521FAC92A873B261, 0xC3C05EE50655E1FA}, {0xE6A797B752909EF9, 0xF4B0769E47EB5A78},
+    {0x9028BED2939A635C, 0x98EE4A22ECF3188B}, {0x7432EE873880FC33, 0xBF29DCABA82FDEAE},
+    {0x113FAA2906A13B3F, 0xEEF453D6923BD65A}, {0x4AC7CA59A424C507, 0x9558B4661B6565F8},
+    {0x5D79BCF00D2DF649, 0xBAAEE17FA23EBF76}, {0xF4D82C2C107973DC, 0xE95A99DF8ACE6F53},
+    {0x79071B9B8A4BE869, 0x91D8A02BB6C10594}, {0x9748E2826CDEE284, 0xB64EC836A47146F9},
+    {0xFD1B1B2308169B25, 0xE3E27A444D8D98B7}, {0xFE30F0F5E50E20F7, 0x8E6D8C6AB0787F72},
+    {0xBDBD2D335E51A935, 0xB208EF855C969F4F}, {0xAD2C788035E61382, 0xDE8B2B66B3BC4723},
+    {0x4C3BCB5021AFCC31, 0x8B16FB203055AC76}, {0xDF4ABE242A1BBF3D, 0xADDCB9E83C6B1793},
+    {0xD71D6DAD34A2AF0D, 0xD953E8624B85DD78}, {0x8672648C40E5AD68, 0x87D4713D6F33AA6B},
+    {0x680EFDAF511F18C2, 0xA9C98D8CCB009506}, {0x0212BD1B2566DEF2, 0xD43BF0EFFDC0BA48},
+    {0x014BB630F7604B57, 0x84A57695FE98746D}, {0x419EA3BD35385E2D, 0xA5CED43B7E3E9188},
+    {0x52064CAC828675B9, 0xCF42894A5DCE35EA}, {0x7343EFEBD1940993, 0x818995CE7AA0E1B2},
+    {0x1014EBE6C5F90BF8, 0xA1EBFB4219491A1F}, {0xD41A26E077774EF6, 0xCA66FA129F9B60A6},
+    {0x8920B098955522B4, 0xFD00B897478238D0}, {0x55B46E5F5D5535B0, 0x9E20735E8CB16382},
+    {0xEB2189F734AA831D, 0xC5A890362FDDBC62}, {0xA5E9EC7501D523E4, 0xF712B443BBD52B7B},
+    {0x47B233C92125366E, 0x9A6BB0AA55653B2D}, {0x999EC0BB696E840A, 0xC1069CD4EABE89F8},
+    {0xC00670EA43CA250D, 0xF148440A256E2C76}, {0x380406926A5E5728, 0x96CD2A865764DBCA},
+    {0xC605083704F5ECF2, 0xBC807527ED3E12BC}, {0xF7864A44C633682E, 0xEBA09271E88D976B},
+    {0x7AB3EE6AFBE0211D, 0x93445B8731587EA3}, {0x5960EA05BAD82964, 0xB8157268FDAE9E4C},
+    {0x6FB92487298E33BD, 0xE61ACF033D1A45DF}, {0xA5D3B6D479F8E056, 0x8FD0C16206306BAB},
+    {0x8F48A4899877186C, 0xB3C4F1BA87BC8696}, {0x331ACDABFE94DE87, 0xE0B62E2929ABA83C},
+    {0x9FF0C08B7F1D0B14, 0x8C71DCD9BA0B4925}, {0x07ECF0AE5EE44DD9, 0xAF8E5410288E1B6F},
+    {0xC9E82CD9F69D6150, 0xDB71E91432B1A24A}, {0xBE311C083A225CD2, 0x892731AC9FAF056E},
+    {0x6DBD630A48AAF406, 0xAB70FE17C79AC6CA}, {0x092CBBCCDAD5B108, 0xD64D3D9DB981787D},
+    {0x25BBF56008C58EA5, 0x85F0468293F0EB4E}, {0xAF2AF2B80AF6F24E, 0xA76C582338ED2621},
+    {0x1AF5AF660DB4AEE1, 0xD1476E2C07286FAA}, {0x50D98D9FC890ED4D, 0x82CCA4DB847945CA},
+    {0xE50FF107BAB528A0, 0xA37FCE126597973C}, {0x1E53ED49A96272C8, 0xCC5FC196FEFD7D0C},
+    {0x25E8E89C13BB0F7A, 0xFF77B1FCBEBCDC4F}, {0x77B191618C54E9AC, 0x9FAACF3DF73609B1},
+    {0xD59DF5B9EF6A2417, 0xC795830D75038C1D}, {0x4B0573286B44AD1D, 0xF97AE3D0D2446F25},
+    {0x4EE367F9430AEC32, 0x9BECCE62836AC577}, {0x229C41F793CDA73F, 0xC2E801FB244576D5},
+    {0x6B43527578C1110F, 0xF3A20279ED56D48A}, {0x830A13896B78AAA9, 0x9845418C345644D6},
+    {0x23CC986BC656D553, 0xBE5691EF416BD60C}, {0x2CBFBE86B7EC8AA8, 0xEDEC366B11C6CB8F},
+    {0x7BF7D71432F3D6A9, 0x94B3A202EB1C3F39}, {0xDAF5CCD93FB0CC53, 0xB9E08A83A5E34F07},
+    {0xD1B3400F8F9CFF68, 0xE858AD248F5C22C9}, {0x23100809B9C21FA1, 0x91376C36D99995BE},
+    {0xABD40A0C2832A78A, 0xB58547448FFFFB2D}, {0x16C90C8F323F516C, 0xE2E69915B3FFF9F9},
+    {0xAE3DA7D97F6792E3, 0x8DD01FAD907FFC3B}, {0x99CD11CFDF41779C, 0xB1442798F49FFB4A},
+    {0x40405643D711D583, 0xDD95317F31C7FA1D}, {0x482835EA666B2572, 0x8A7D3EEF7F1CFC52},
+    {0xDA3243650005EECF, 0xAD1C8EAB5EE43B66}, {0x90BED43E40076A82, 0xD863B256369D4A40},
+    {0x5A7744A6E804A291, 0x873E4F75E2224E68}, {0x711515D0A205CB36, 0xA90DE3535AAAE202},
+    {0x0D5A5B44CA873E03, 0xD3515C2831559A83}, {0xE858790AFE9486C2, 0x8412D9991ED58091},
+    {0x626E974DBE39A872, 0xA5178FFF668AE0B6}, {0xFB0A3D212DC8128F, 0xCE5D73FF402D98E3},
+    {0x7CE66634BC9D0B99, 0x80FA687F881C7F8E}, {0x1C1FFFC1EBC44E80, 0xA139029F6A239F72},
+    {0xA327FFB266B56220, 0xC987434744AC874E}, {0x4BF1FF9F0062BAA8, 0xFBE9141915D7A922},
+    {0x6F773FC3603DB4A9, 0x9D71AC8FADA6C9B5}, {0xCB550FB4384D21D3, 0xC4CE17B399107C22},
+    {0x7E2A53A146606A48, 0xF6019DA07F549B2B}, {0x2EDA7444CBFC426D, 0x99C102844F94E0FB},
+    {0xFA911155FEFB5308, 0xC0314325637A1939}, {0x793555AB7EBA27CA, 0xF03D93EEBC589F88},
+    {0x4BC1558B2F3458DE, 0x96267C7535B763B5}, {0x9EB1AAEDFB016F16, 0xBBB01B9283253CA2},
+    {0x465E15A979C1CADC, 0xEA9C227723EE8BCB}, {0x0BFACD89EC191EC9, 0x92A1958A7675175F},
+    {0xCEF980EC671F667B, 0xB749FAED14125D36}, {0x82B7E12780E7401A, 0xE51C79A85916F484},
+    {0xD1B2ECB8B0908810, 0x8F31CC0937AE58D2}, {0x861FA7E6DCB4AA15, 0xB2FE3F0B8599EF07},
+    {0x67A791E093E1D49A, 0xDFBDCECE67006AC9}, {0xE0C8BB2C5C6D24E0, 0x8BD6A141006042BD},
+    {0x58FAE9F773886E18, 0xAECC49914078536D}, {0xAF39A475506A899E, 0xDA7F5BF590966848},
+    {0x6D8406C952429603, 0x888F99797A5E012D}, {0xC8E5087BA6D33B83, 0xAAB37FD7D8F58178},
+    {0xFB1E4A9A90880A64, 0xD5605FCDCF32E1D6}, {0x5CF2EEA09A55067F, 0x855C3BE0A17FCD26},
+    {0xF42FAA48C0EA481E, 0xA6B34AD8C9DFC06F}, {0xF13B94DAF124DA26, 0xD0601D8EFC57B08B},
+    {0x76C53D08D6B70858, 0x823C12795DB6CE57}, {0x54768C4B0C64CA6E, 0xA2CB1717B52481ED},
+    {0xA9942F5DCF7DFD09, 0xCB7DDCDDA26DA268}, {0xD3F93B35435D7C4C, 0xFE5D54150B090B02},
+    {0xC47BC5014A1A6DAF, 0x9EFA548D26E5A6E1}, {0x359AB6419CA1091B, 0xC6B8E9B0709F109A},
+    {0xC30163D203C94B62, 0xF867241C8CC6D4C0}, {0x79E0DE63425DCF1D, 0x9B407691D7FC44F8},
+    {0x985915FC12F542E4, 0xC21094364DFB5636}, {0x3E6F5B7B17B2939D, 0xF294B943E17A2BC4},
+    {0xA705992CEECF9C42, 0x979CF3CA6CEC5B5A}, {0x50C6FF782A838353, 0xBD8430BD08277231},
+    {0xA4F8BF5635246428, 0xECE53CEC4A314EBD}, {0x871B7795E136BE99, 0x940F4613AE5ED136},
+    {0x28E2557B59846E3F, 0xB913179899F68584}, {0x331AEADA2FE589CF, 0xE757DD7EC07426E5},
+    {0x3FF0D2C85DEF7621, 0x9096EA6F3848984F}, {0x0FED077A756B53A9, 0xB4BCA50B065ABE63},
+    {0xD3E8495912C62894, 0xE1EBCE4DC7F16DFB}, {0x64712DD7ABBBD95C, 0x8D3360F09CF6E4BD},
+    {0xBD8D794D96AACFB3, 0xB080392CC4349DEC}, {0xECF0D7A0FC5583A0, 0xDCA04777F541C567},
+    {0xF41686C49DB57244, 0x89E42CAAF9491B60}, {0x311C2875C522CED5, 0xAC5D37D5B79B6239},
+    {0x7D633293366B828B, 0xD77485CB25823AC7}, {0xAE5DFF9C02033197, 0x86A8D39EF77164BC},
+    {0xD9F57F830283FDFC, 0xA8530886B54DBDEB}, {0xD072DF63C324FD7B, 0xD267CAA862A12D66},
+    {0x4247CB9E59F71E6D, 0x8380DEA93DA4BC60}, {0x52D9BE85F074E608, 0xA46116538D0DEB78},
+    {0x67902E276C921F8B, 0xCD795BE870516656}, {0x00BA1CD8A3DB53B6, 0x806BD9714632DFF6},
+    {0x80E8A40ECCD228A4, 0xA086CFCD97BF97F3}, {0x6122CD128006B2CD, 0xC8A883C0FDAF7DF0},
+    {0x796B805720085F81, 0xFAD2A4B13D1B5D6C}, {0xCBE3303674053BB0, 0x9CC3A6EEC6311A63},
+    {0xBEDBFC4411068A9C, 0xC3F490AA77BD60FC}, {0xEE92FB5515482D44, 0xF4F1B4D515ACB93B},
+    {0x751BDD152D4D1C4A, 0x991711052D8BF3C5}, {0xD262D45A78A0635D, 0xBF5CD54678EEF0B6},
+    {0x86FB897116C87C34, 0xEF340A98172AACE4}, {0xD45D35E6AE3D4DA0, 0x9580869F0E7AAC0E},
+    {0x8974836059CCA109, 0xBAE0A846D2195712}, {0x2BD1A438703FC94B, 0xE998D258869FACD7},
+    {0x7B6306A34627DDCF, 0x91FF83775423CC06}, {0x1A3BC84C17B1D542, 0xB67F6455292CBF08},
+    {0x20CABA5F1D9E4A93, 0xE41F3D6A7377EECA}, {0x547EB47B7282EE9C, 0x8E938662882AF53E},
+    {0xE99E619A4F23AA43, 0xB23867FB2A35B28D}, {0x6405FA00E2EC94D4, 0xDEC681F9F4C31F31},
+    {0xDE83BC408DD3DD04, 0x8B3C113C38F9F37E}, {0x9624AB50B148D445, 0xAE0B158B4738705E},
+    {0x3BADD624DD9B0957, 0xD98DDAEE19068C76}, {0xE54CA5D70A80E5D6, 0x87F8A8D4CFA417C9},
+    {0x5E9FCF4CCD211F4C, 0xA9F6D30A038D1DBC}, {0x7647C3200069671F, 0xD47487CC8470652B},
+    {0x29ECD9F40041E073, 0x84C8D4DFD2C63F3B}, {0xF468107100525890, 0xA5FB0A17C777CF09},
+    {0x7182148D4066EEB4, 0xCF79CC9DB955C2CC}, {0xC6F14CD848405530, 0x81AC1FE293D599BF},
+    {0xB8ADA00E5A506A7C, 0xA21727DB38CB002F}, {0xA6D90811F0E4851C, 0xCA9CF1D206FDC03B},
+    {0x908F4A166D1DA663, 0xFD442E4688BD304A}, {0x9A598E4E043287FE, 0x9E4A9CEC15763E2E},
+    {0x40EFF1E1853F29FD, 0xC5DD44271AD3CDBA}, {0xD12BEE59E68EF47C, 0xF7549530E188C128},
+    {0x82BB74F8301958CE, 0x9A94DD3E8CF578B9}, {0xE36A52363C1FAF01, 0xC13A148E3032D6E7},
+    {0xDC44E6C3CB279AC1, 0xF18899B1BC3F8CA1}, {0x29AB103A5EF8C0B9, 0x96F5600F15A7B7E5},
+    {0x7415D448F6B6F0E7, 0xBCB2B812DB11A5DE}, {0x111B495B3464AD21, 0xEBDF661791D60F56},
+    {0xCAB10DD900BEEC34, 0x936B9FCEBB25C995}, {0x3D5D514F40EEA742, 0xB84687C269EF3BFB},
+    {0x0CB4A5A3112A5112, 0xE65829B3046B0AFA}, {0x47F0E785EABA72AB, 0x8FF71A0FE2C2E6DC},
+    {0x59ED216765690F56, 0xB3F4E093DB73A093}, {0x306869C13EC3532C, 0xE0F218B8D25088B8},
+    {0x1E414218C73A13FB, 0x8C974F7383725573}, {0xE5D1929EF90898FA, 0xAFBD2350644EEACF},
+    {0xDF45F746B74ABF39, 0xDBAC6C247D62A583}, {0x6B8BBA8C328EB783, 0x894BC396CE5DA772},
+    {0x066EA92F3F326564, 0xAB9EB47C81F5114F}, {0xC80A537B0EFEFEBD, 0xD686619BA27255A2},
+    {0xBD06742CE95F5F36, 0x8613FD0145877585}, {0x2C48113823B73704, 0xA798FC4196E952E7},
+    {0xF75A15862CA504C5, 0xD17F3B51FCA3A7A0}, {0x9A984D73DBE722FB, 0x82EF85133DE648C4},
+    {0xC13E60D0D2E0EBBA, 0xA3AB66580D5FDAF5}, {0x318DF905079926A8, 0xCC963FEE10B7D1B3},
+    {0xFDF17746497F7052, 0xFFBBCFE994E5C61F}, {0xFEB6EA8BEDEFA633, 0x9FD561F1FD0F9BD3},
+    {0xFE64A52EE96B8FC0, 0xC7CABA6E7C5382C8}, {0x3DFDCE7AA3C673B0, 0xF9BD690A1B68637B},
+    {0x06BEA10CA65C084E, 0x9C1661A651213E2D}, {0x486E494FCFF30A62, 0xC31BFA0FE5698DB8},
+    {0x5A89DBA3C3EFCCFA, 0xF3E2F893DEC3F126}, {0xF89629465A75E01C, 0x986DDB5C6B3A76B7},
+    {0xF6BBB397F1135823, 0xBE89523386091465}, {0x746AA07DED582E2C, 0xEE2BA6C0678B597F},
+    {0xA8C2A44EB4571CDC, 0x94DB483840B717EF}, {0x92F34D62616CE413, 0xBA121A4650E4DDEB},
+    {0x77B020BAF9C81D17, 0xE896A0D7E51E1566}, {0x0ACE1474DC1D122E, 0x915E2486EF32CD60},
+    {0x0D819992132456BA, 0xB5B5ADA8AAFF80B8}, {0x10E1FFF697ED6C69, 0xE3231912D5BF60E6},
+    {0xCA8D3FFA1EF463C1, 0x8DF5EFABC5979C8F}, {0xBD308FF8A6B17CB2, 0xB1736B96B6FD83B3},
+    {0xAC7CB3F6D05DDBDE, 0xDDD0467C64BCE4A0}, {0x6BCDF07A423AA96B, 0x8AA22C0DBEF60EE4},
+    {0x86C16C98D2C953C6, 0xAD4AB7112EB3929D}, {0xE871C7BF077BA8B7, 0xD89D64D57A607744},
+    {0x11471CD764AD4972, 0x87625F056C7C4A8B}, {0xD598E40D3DD89BCF, 0xA93AF6C6C79B5D2D},
+    {0x4AFF1D108D4EC2C3, 0xD389B47879823479}, {0xCEDF722A585139BA, 0x843610CB4BF160CB},
+    {0xC2974EB4EE658828, 0xA54394FE1EEDB8FE}, {0x733D226229FEEA32, 0xCE947A3DA6A9273E},
+    {0x0806357D5A3F525F, 0x811CCC668829B887}, {0xCA07C2DCB0CF26F7, 0xA163FF802A3426A8},
+    {0xFC89B393DD02F0B5, 0xC9BCFF6034C13052}, {0xBBAC2078D443ACE2, 0xFC2C3F3841F17C67},
+    {0xD54B944B84AA4C0D, 0x9D9BA7832936EDC0}, {0x0A9E795E65D4DF11, 0xC5029163F384A931},
+    {0x4D4617B5FF4A16D5, 0xF64335BCF065D37D}, {0x504BCED1BF8E4E45, 0x99EA0196163FA42E},
+    {0xE45EC2862F71E1D6, 0xC06481FB9BCF8D39}, {0x5D767327BB4E5A4C, 0xF07DA27A82C37088},
+    {0x3A6A07F8D510F86F, 0x964E858C91BA2655}, {0x890489F70A55368B, 0xBBE226EFB628AFEA},
+    {0x2B45AC74CCEA842E, 0xEADAB0ABA3B2DBE5}, {0x3B0B8BC90012929D, 0x92C8AE6B464FC96F},
+    {0x09CE6EBB40173744, 0xB77ADA0617E3BBCB}, {0xCC420A6A101D0515, 0xE55990879DDCAABD},
+    {0x9FA946824A12232D, 0x8F57FA54C2A9EAB6}, {0x47939822DC96ABF9, 0xB32DF8E9F3546564},
+    {0x59787E2B93BC56F7, 0xDFF9772470297EBD}, {0x57EB4EDB3C55B65A, 0x8BFBEA76C619EF36},
+    {0xEDE622920B6B23F1, 0xAEFAE51477A06B03}, {0xE95FAB368E45ECED, 0xDAB99E59958885C4},
+    {0x11DBCB0218EBB414, 0x88B402F7FD75539B}, {0xD652BDC29F26A119, 0xAAE103B5FCD2A881},
+    {0x4BE76D3346F0495F, 0xD59944A37C0752A2}, {0x6F70A4400C562DDB, 0x857FCAE62D8493A5},
+    {0xCB4CCD500F6BB952, 0xA6DFBD9FB8E5B88E}, {0x7E2000A41346A7A7, 0xD097AD07A71F26B2},
+    {0x8ED400668C0C28C8, 0x825ECC24C873782F}, {0x728900802F0F32FA, 0xA2F67F2DFA90563B},
+    {0x4F2B40A03AD2FFB9, 0xCBB41EF979346BCA}, {0xE2F610C84987BFA8, 0xFEA126B7D78186BC},
+    {0x0DD9CA7D2DF4D7C9, 0x9F24B832E6B0F436}, {0x91503D1C79720DBB, 0xC6EDE63FA05D3143},
+    {0x75A44C6397CE912A, 0xF8A95FCF88747D94}, {0xC986AFBE3EE11ABA, 0x9B69DBE1B548CE7C},
+    {0xFBE85BADCE996168, 0xC24452DA229B021B}, {0xFAE27299423FB9C3, 0xF2D56790AB41C2A2},
+    {0xDCCD879FC967D41A, 0x97C560BA6B0919A5}, {0x5400E987BBC1C920, 0xBDB6B8E905CB600F},
+    {0x290123E9AAB23B68, 0xED246723473E3813}, {0xF9A0B6720AAF6521, 0x9436C0760C86E30B},
+    {0xF808E40E8D5B3E69, 0xB94470938FA89BCE}, {0xB60B1D1230B20E04, 0xE7958CB87392C2C2},
+    {0xB1C6F22B5E6F48C2, 0x90BD77F3483BB9B9}, {0x1E38AEB6360B1AF3, 0xB4ECD5F01A4AA828},
+    {0x25C6DA63C38DE1B0, 0xE2280B6C20DD5232}, {0x579C487E5A38AD0E, 0x8D590723948A535F},
+    {0x2D835A9DF0C6D851, 0xB0AF48EC79ACE837}, {0xF8E431456CF88E65, 0xDCDB1B2798182244},
+    {0x1B8E9ECB641B58FF, 0x8A08F0F8BF0F156B}, {0xE272467E3D222F3F, 0xAC8B2D36EED2DAC5},
+    {0x5B0ED81DCC6ABB0F, 0xD7ADF884AA879177}, {0x98E947129FC2B4E9, 0x86CCBB52EA94BAEA},
+    {0x3F2398D747B36224, 0xA87FEA27A539E9A5}, {0x8EEC7F0D19A03AAD, 0xD29FE4B18E88640E},
+    {0x1953CF68300424AC, 0x83A3EEEEF9153E89}, {0x5FA8C3423C052DD7, 0xA48CEAAAB75A8E2B},
+    {0x3792F412CB06794D, 0xCDB02555653131B6}, {0xE2BBD88BBEE40BD0, 0x808E17555F3EBF11},
+    {0x5B6ACEAEAE9D0EC4, 0xA0B19D2AB70E6ED6}, {0xF245825A5A445275, 0xC8DE047564D20A8B},
+    {0xEED6E2F0F0D56712, 0xFB158592BE068D2E}, {0x55464DD69685606B, 0x9CED737BB6C4183D},
+    {0xAA97E14C3C26B886, 0xC428D05AA4751E4C}, {0xD53DD99F4B3066A8, 0xF53304714D9265DF},
+    {0xE546A8038EFE4029, 0x993FE2C6D07B7FAB}, {0xDE98520472BDD033, 0xBF8FDB78849A5F96},
+    {0x963E66858F6D4440, 0xEF73D256A5C0F77C}, {0xDDE7001379A44AA8, 0x95A8637627989AAD},
+    {0x5560C018580D5D52, 0xBB127C53B17EC159}, {0xAAB8F01E6E10B4A6, 0xE9D71B689DDE71AF},
+    {0xCAB3961304CA70E8, 0x9226712162AB070D}, {0x3D607B97C5FD0D22, 0xB6B00D69BB55C8D1},
+    {0x8CB89A7DB77C506A, 0xE45C10C42A2B3B05}, {0x77F3608E92ADB242, 0x8EB98A7A9A5B04E3},
+    {0x55F038B237591ED3, 0xB267ED1940F1C61C}, {0x6B6C46DEC52F6688, 0xDF01E85F912E37A3},
+    {0x2323AC4B3B3DA015, 0x8B61313BBABCE2C6}, {0xABEC975E0A0D081A, 0xAE397D8AA96C1B77},
+    {0x96E7BD358C904A21, 0xD9C7DCED53C72255}, {0x7E50D64177DA2E54, 0x881CEA14545C7575},
+    {0xDDE50BD1D5D0B9E9, 0xAA242499697392D2}, {0x955E4EC64B44E864, 0xD4AD2DBFC3D07787},
+    {0xBD5AF13BEF0B113E, 0x84EC3C97DA624AB4}, {0xECB1AD8AEACDD58E, 0xA6274BBDD0FADD61},
+    {0x67DE18EDA5814AF2, 0xCFB11EAD453994BA}, {0x80EACF948770CED7, 0x81CEB32C4B43FCF4},
+    {0xA1258379A94D028D, 0xA2425FF75E14FC31}, {0x096EE45813A04330, 0xCAD2F7F5359A3B3E},
+    {0x8BCA9D6E188853FC, 0xFD87B5F28300CA0D}, {0x775EA264CF55347D, 0x9E74D1B791E07E48},
+    {0x95364AFE032A819D, 0xC612062576589DDA}, {0x3A83DDBD83F52204, 0xF79687AED3EEC551},
+    {0xC4926A9672793542, 0x9ABE14CD44753B52}, {0x75B7053C0F178293, 0xC16D9A0095928A27},
+    {0x5324C68B12DD6338, 0xF1C90080BAF72CB1}, {0xD3F6FC16EBCA5E03, 0x971DA05074DA7BEE},
+    {0x88F4BB1CA6BCF584, 0xBCE5086492111AEA}, {0x2B31E9E3D06C32E5, 0xEC1E4A7DB69561A5},
+    {0x3AFF322E62439FCF, 0x9392EE8E921D5D07}, {0x09BEFEB9FAD487C2, 0xB877AA3236A4B449},
+    {0x4C2EBE687989A9B3, 0xE69594BEC44DE15B}, {0x0F9D37014BF60A10, 0x901D7CF73AB0ACD9},
+    {0x538484C19EF38C94, 0xB424DC35095CD80F}, {0x2865A5F206B06FB9, 0xE12E13424BB40E13},
+    {0xF93F87B7442E45D3, 0x8CBCCC096F5088CB}, {0xF78F69A51539D748, 0xAFEBFF0BCB24AAFE},
+    {0xB573440E5A884D1B, 0xDBE6FECEBDEDD5BE}, {0x31680A88F8953030, 0x89705F4136B4A597},
+    {0xFDC20D2B36BA7C3D, 0xABCC77118461CEFC}, {0x3D32907604691B4C, 0xD6BF94D5E57A42BC},
+    {0xA63F9A49C2C1B10F, 0x8637BD05AF6C69B5}, {0x0FCF80DC33721D53, 0xA7C5AC471B478423},
+    {0xD3C36113404EA4A8, 0xD1B71758E219652B}, {0x645A1CAC083126E9, 0x83126E978D4FDF3B},
+    {0x3D70A3D70A3D70A3, 0xA3D70A3D70A3D70A}, {0xCCCCCCCCCCCCCCCC, 0xCCCCCCCCCCCCCCCC},
+    {0x0000000000000000, 0x8000000000000000}, {0x0000000000000000, 0xA000000000000000},
+    {0x0000000000000000, 0xC800000000000000}, {0x0000000000000000, 0xFA00000000000000},
+    {0x0000000000000000, 0x9C40000000000000}, {0x0000000000000000, 0xC350000000000000},
+    {0x0000000000000000, 0xF424000000000000}, {0x0000000000000000, 0x9896800000000000},
+    {0x0000000000000000, 0xBEBC200000000000}, {0x0000000000000000, 0xEE6B280000000000},
+    {0x0000000000000000, 0x9502F90000000000}, {0x0000000000000000, 0xBA43B74000000000},
+    {0x0000000000000000, 0xE8D4A51000000000}, {0x0000000000000000, 0x9184E72A00000000},
+    {0x0000000000000000, 0xB5E620F480000000}, {0x0000000000000000, 0xE35FA931A0000000},
+    {0x0000000000000000, 0x8E1BC9BF04000000}, {0x0000000000000000, 0xB1A2BC2EC5000000},
+    {0x0000000000000000, 0xDE0B6B3A76400000}, {0x0000000000000000, 0x8AC7230489E80000},
+    {0x0000000000000000, 0xAD78EBC5AC620000}, {0x0000000000000000, 0xD8D726B7177A8000},
+    {0x0000000000000000, 0x878678326EAC9000}, {0x0000000000000000, 0xA968163F0A57B400},
+    {0x0000000000000000, 0xD3C21BCECCEDA100}, {0x0000000000000000, 0x84595161401484A0},
+    {0x0000000000000000, 0xA56FA5B99019A5C8}, {0x0000000000000000, 0xCECB8F27F4200F3A},
+    {0x4000000000000000, 0x813F3978F8940984}, {0x5000000000000000, 0xA18F07D736B90BE5},
+    {0xA400000000000000, 0xC9F2C9CD04674EDE}, {0x4D00000000000000, 0xFC6F7C4045812296},
+    {0xF020000000000000, 0x9DC5ADA82B70B59D}, {0x6C28000000000000, 0xC5371912364CE305},
+    {0xC732000000000000, 0xF684DF56C3E01BC6}, {0x3C7F400000000000, 0x9A130B963A6C115C},
+    {0x4B9F100000000000, 0xC097CE7BC90715B3}, {0x1E86D40000000000, 0xF0BDC21ABB48DB20},
+    {0x1314448000000000, 0x96769950B50D88F4}, {0x17D955A000000000, 0xBC143FA4E250EB31},
+    {0x5DCFAB0800000000, 0xEB194F8E1AE525FD}, {0x5AA1CAE500000000, 0x92EFD1B8D0CF37BE},
+    {0xF14A3D9E40000000, 0xB7ABC627050305AD}, {0x6D9CCD05D0000000, 0xE596B7B0C643C719},
+    {0xE4820023A2000000, 0x8F7E32CE7BEA5C6F}, {0xDDA2802C8A800000, 0xB35DBF821AE4F38B},
+    {0xD50B2037AD200000, 0xE0352F62A19E306E}, {0x4526F422CC340000, 0x8C213D9DA502DE45},
+    {0x9670B12B7F410000, 0xAF298D050E4395D6}, {0x3C0CDD765F114000, 0xDAF3F04651D47B4C},
+    {0xA5880A69FB6AC800, 0x88D8762BF324CD0F}, {0x8EEA0D047A457A00, 0xAB0E93B6EFEE0053},
+    {0x72A4904598D6D880, 0xD5D238A4ABE98068}, {0x47A6DA2B7F864750, 0x85A36366EB71F041},
+    {0x999090B65F67D924, 0xA70C3C40A64E6C51}, {0xFFF4B4E3F741CF6D, 0xD0CF4B50CFE20765},
+    {0xBFF8F10E7A8921A4, 0x82818F1281ED449F}, {0xAFF72D52192B6A0D, 0xA321F2D7226895C7},
+    {0x9BF4F8A69F764490, 0xCBEA6F8CEB02BB39}, {0x02F236D04753D5B4, 0xFEE50B7025C36A08},
+    {0x01D762422C946590, 0x9F4F2726179A2245}, {0x424D3AD2B7B97EF5, 0xC722F0EF9D80AAD6},
+    {0xD2E0898765A7DEB2, 0xF8EBAD2B84E0D58B}, {0x63CC55F49F88EB2F, 0x9B934C3B330C8577},
+    {0x3CBF6B71C76B25FB, 0xC2781F49FFCFA6D5}, {0x8BEF464E3945EF7A, 0xF316271C7FC3908A},
+    {0x97758BF0E3CBB5AC, 0x97EDD871CFDA3A56}, {0x3D52EEED1CBEA317, 0xBDE94E8E43D0C8EC},
+    {0x4CA7AAA863EE4BDD, 0xED63A231D4C4FB27}, {0x8FE8CAA93E74EF6A, 0x945E455F24FB1CF8},
+    {0xB3E2FD538E122B44, 0xB975D6B6EE39E436}, {0x60DBBCA87196B616, 0xE7D34C64A9C85D44},
+    {0xBC8955E946FE31CD, 0x90E40FBEEA1D3A4A}, {0x6BABAB6398BDBE41, 0xB51D13AEA4A488DD},
+    {0xC696963C7EED2DD1, 0xE264589A4DCDAB14}, {0xFC1E1DE5CF543CA2, 0x8D7EB76070A08AEC},
+    {0x3B25A55F43294BCB, 0xB0DE65388CC8ADA8}, {0x49EF0EB713F39EBE, 0xDD15FE86AFFAD912},
+    {0x6E3569326C784337, 0x8A2DBF142DFCC7AB}, {0x49C2C37F07965404, 0xACB92ED9397BF996},
+    {0xDC33745EC97BE906, 0xD7E77A8F87DAF7FB}, {0x69A028BB3DED71A3, 0x86F0AC99B4E8DAFD},
+    {0xC40832EA0D68CE0C, 0xA8ACD7C0222311BC}, {0xF50A3FA490C30190, 0xD2D80DB02AABD62B},
+    {0x792667C6DA79E0FA, 0x83C7088E1AAB65DB}, {0x577001B891185938, 0xA4B8CAB1A1563F52},
+    {0xED4C0226B55E6F86, 0xCDE6FD5E09ABCF26}, {0x544F8158315B05B4, 0x80B05E5AC60B6178},
+    {0x696361AE3DB1C721, 0xA0DC75F1778E39D6}, {0x03BC3A19CD1E38E9, 0xC913936DD571C84C},
+    {0x04AB48A04065C723, 0xFB5878494ACE3A5F}, {0x62EB0D64283F9C76, 0x9D174B2DCEC0E47B},
+    {0x3BA5D0BD324F8394, 0xC45D1DF942711D9A}, {0xCA8F44EC7EE36479, 0xF5746577930D6500},
+    {0x7E998B13CF4E1ECB, 0x9968BF6ABBE85F20}, {0x9E3FEDD8C321A67E, 0xBFC2EF456AE276E8},
+    {0xC5CFE94EF3EA101E, 0xEFB3AB16C59B14A2}, {0xBBA1F1D158724A12, 0x95D04AEE3B80ECE5},
+    {0x2A8A6E45AE8EDC97, 0xBB445DA9CA61281F}, {0xF52D09D71A3293BD, 0xEA1575143CF97226},
+    {0x593C2626705F9C56, 0x924D692CA61BE758}, {0x6F8B2FB00C77836C, 0xB6E0C377CFA2E12E},
+    {0x0B6DFB9C0F956447, 0xE498F455C38B997A}, {0x4724BD4189BD5EAC, 0x8EDF98B59A373FEC},
+    {0x58EDEC91EC2CB657, 0xB2977EE300C50FE7}, {0x2F2967B66737E3ED, 0xDF3D5E9BC0F653E1},
+    {0xBD79E0D20082EE74, 0x8B865B215899F46C}, {0xECD8590680A3AA11, 0xAE67F1E9AEC07187},
+    {0xE80E6F4820CC9495, 0xDA01EE641A708DE9}, {0x3109058D147FDCDD, 0x884134FE908658B2},
+    {0xBD4B46F0599FD415, 0xAA51823E34A7EEDE}, {0x6C9E18AC7007C91A, 0xD4E5E2CDC1D1EA96},
+    {0x03E2CF6BC604DDB0, 0x850FADC09923329E}, {0x84DB8346B786151C, 0xA6539930BF6BFF45},
+    {0xE612641865679A63, 0xCFE87F7CEF46FF16}, {0x4FCB7E8F3F60C07E, 0x81F14FAE158C5F6E},
+    {0xE3BE5E330F38F09D, 0xA26DA3999AEF7749}, {0x5CADF5BFD3072CC5, 0xCB090C8001AB551C},
+    {0x73D9732FC7C8F7F6, 0xFDCB4FA002162A63}, {0x2867E7FDDCDD9AFA, 0x9E9F11C4014DDA7E},
+    {0xB281E1FD541501B8, 0xC646D63501A1511D}, {0x1F225A7CA91A4226, 0xF7D88BC24209A565},
+    {0x3375788DE9B06958, 0x9AE757596946075F}, {0x0052D6B1641C83AE, 0xC1A12D2FC3978937},
+    {0xC0678C5DBD23A49A, 0xF209787BB47D6B84}, {0xF840B7BA963646E0, 0x9745EB4D50CE6332},
+    {0xB650E5A93BC3D898, 0xBD176620A501FBFF}, {0xA3E51F138AB4CEBE, 0xEC5D3FA8CE427AFF},
+    {0xC66F336C36B10137, 0x93BA47C980E98CDF}, {0xB80B0047445D4184, 0xB8A8D9BBE123F017},
+    {0xA60DC059157491E5, 0xE6D3102AD96CEC1D}, {0x87C89837AD68DB2F, 0x9043EA1AC7E41392},
+    {0x29BABE4598C311FB, 0xB454E4A179DD1877}, {0xF4296DD6FEF3D67A, 0xE16A1DC9D8545E94},
+    {0x1899E4A65F58660C, 0x8CE2529E2734BB1D}, {0x5EC05DCFF72E7F8F, 0xB01AE745B101E9E4},
+    {0x76707543F4FA1F73, 0xDC21A1171D42645D}, {0x6A06494A791C53A8, 0x899504AE72497EBA},
+    {0x0487DB9D17636892, 0xABFA45DA0EDBDE69}, {0x45A9D2845D3C42B6, 0xD6F8D7509292D603},
+    {0x0B8A2392BA45A9B2, 0x865B86925B9BC5C2}, {0x8E6CAC7768D7141E, 0xA7F26836F282B732},
+    {0x3207D795430CD926, 0xD1EF0244AF2364FF}, {0x7F44E6BD49E807B8, 0x8335616AED761F1F},
+    {0x5F16206C9C6209A6, 0xA402B9C5A8D3A6E7}, {0x36DBA887C37A8C0F, 0xCD036837130890A1},
+    {0xC2494954DA2C9789, 0x802221226BE55A64}, {0xF2DB9BAA10B7BD6C, 0xA02AA96B06DEB0FD},
+    {0x6F92829494E5ACC7, 0xC83553C5C8965D3D}, {0xCB772339BA1F17F9, 0xFA42A8B73ABBF48C},
+    {0xFF2A760414536EFB, 0x9C69A97284B578D7}, {0xFEF5138519684ABA, 0xC38413CF25E2D70D},
+    {0x7EB258665FC25D69, 0xF46518C2EF5B8CD1}, {0xEF2F773FFBD97A61, 0x98BF2F79D5993802},
+    {0xAAFB550FFACFD8FA, 0xBEEEFB584AFF8603}, {0x95BA2A53F983CF38, 0xEEAABA2E5DBF6784},
+    {0xDD945A747BF26183, 0x952AB45CFA97A0B2}, {0x94F971119AEEF9E4, 0xBA756174393D88DF},
+    {0x7A37CD5601AAB85D, 0xE912B9D1478CEB17}, {0xAC62E055C10AB33A, 0x91ABB422CCB812EE},
+    {0x577B986B314D6009, 0xB616A12B7FE617AA}, {0xED5A7E85FDA0B80B, 0xE39C49765FDF9D94},
+    {0x14588F13BE847307, 0x8E41ADE9FBEBC27D}, {0x596EB2D8AE258FC8, 0xB1D219647AE6B31C},
+    {0x6FCA5F8ED9AEF3BB, 0xDE469FBD99A05FE3}, {0x25DE7BB9480D5854, 0x8AEC23D680043BEE},
+    {0xAF561AA79A10AE6A, 0xADA72CCC20054AE9}, {0x1B2BA1518094DA04, 0xD910F7FF28069DA4},
+    {0x90FB44D2F05D0842, 0x87AA9AFF79042286}, {0x353A1607AC744A53, 0xA99541BF57452B28},
+    {0x42889B8997915CE8, 0xD3FA922F2D1675F2}, {0x69956135FEBADA11, 0x847C9B5D7C2E09B7},
+    {0x43FAB9837E699095, 0xA59BC234DB398C25}, {0x94F967E45E03F4BB, 0xCF02B2C21207EF2E},
+    {0x1D1BE0EEBAC278F5, 0x8161AFB94B44F57D}, {0x6462D92A69731732, 0xA1BA1BA79E1632DC},
+    {0x7D7B8F7503CFDCFE, 0xCA28A291859BBF93}, {0x5CDA735244C3D43E, 0xFCB2CB35E702AF78},
+    {0x3A0888136AFA64A7, 0x9DEFBF01B061ADAB}, {0x088AAA1845B8FDD0, 0xC56BAEC21C7A1916},
+    {0x8AAD549E57273D45, 0xF6C69A72A3989F5B}, {0x36AC54E2F678864B, 0x9A3C2087A63F6399},
+    {0x84576A1BB416A7DD, 0xC0CB28A98FCF3C7F}, {0x656D44A2A11C51D5, 0xF0FDF2D3F3C30B9F},
+    {0x9F644AE5A4B1B325, 0x969EB7C47859E743}, {0x873D5D9F0DDE1FEE, 0xBC4665B596706114},
+    {0xA90CB506D155A7EA, 0xEB57FF22FC0C7959}, {0x09A7F12442D588F2, 0x9316FF75DD87CBD8},
+    {0x0C11ED6D538AEB2F, 0xB7DCBF5354E9BECE}, {0x8F1668C8A86DA5FA, 0xE5D3EF282A242E81},
+    {0xF96E017D694487BC, 0x8FA475791A569D10}, {0x37C981DCC395A9AC, 0xB38D92D760EC4455},
+    {0x85BBE253F47B1417, 0xE070F78D3927556A}, {0x93956D7478CCEC8E, 0x8C469AB843B89562},
+    {0x387AC8D1970027B2, 0xAF58416654A6BABB}, {0x06997B05FCC0319E, 0xDB2E51BFE9D0696A},
+    {0x441FECE3BDF81F03, 0x88FCF317F22241E2}, {0xD527E81CAD7626C3, 0xAB3C2FDDEEAAD25A},
+    {0x8A71E223D8D3B074, 0xD60B3BD56A5586F1}, {0xF6872D5667844E49, 0x85C7056562757456},
+    {0xB428F8AC016561DB, 0xA738C6BEBB12D16C}, {0xE13336D701BEBA52, 0xD106F86E69D785C7},
+    {0xECC0024661173473, 0x82A45B450226B39C}, {0x27F002D7F95D0190, 0xA34D721642B06084},
+    {0x31EC038DF7B441F4, 0xCC20CE9BD35C78A5}, {0x7E67047175A15271, 0xFF290242C83396CE},
+    {0x0F0062C6E984D386, 0x9F79A169BD203E41}, {0x52C07B78A3E60868, 0xC75809C42C684DD1},
+    {0xA7709A56CCDF8A82, 0xF92E0C3537826145}, {0x88A66076400BB691, 0x9BBCC7A142B17CCB},
+    {0x6ACFF893D00EA435, 0xC2ABF989935DDBFE}, {0x0583F6B8C4124D43, 0xF356F7EBF83552FE},
+    {0xC3727A337A8B704A, 0x98165AF37B2153DE}, {0x744F18C0592E4C5C, 0xBE1BF1B059E9A8D6},
+    {0x1162DEF06F79DF73, 0xEDA2EE1C7064130C}, {0x8ADDCB5645AC2BA8, 0x9485D4D1C63E8BE7},
+    {0x6D953E2BD7173692, 0xB9A74A0637CE2EE1}, {0xC8FA8DB6CCDD0437, 0xE8111C87C5C1BA99},
+    {0x1D9C9892400A22A2, 0x910AB1D4DB9914A0}, {0x2503BEB6D00CAB4B, 0xB54D5E4A127F59C8},
+    {0x2E44AE64840FD61D, 0xE2A0B5DC971F303A}, {0x5CEAECFED289E5D2, 0x8DA471A9DE737E24},
+    {0x7425A83E872C5F47, 0xB10D8E1456105DAD}, {0xD12F124E28F77719, 0xDD50F1996B947518},
+    {0x82BD6B70D99AAA6F, 0x8A5296FFE33CC92F}, {0x636CC64D1001550B, 0xACE73CBFDC0BFB7B},
+    {0x3C47F7E05401AA4E, 0xD8210BEFD30EFA5A}, {0x65ACFAEC34810A71, 0x8714A775E3E95C78},
+    {0x7F1839A741A14D0D, 0xA8D9D1535CE3B396}, {0x1EDE48111209A050, 0xD31045A8341CA07C},
+    {0x934AED0AAB460432, 0x83EA2B892091E44D}, {0xF81DA84D5617853F, 0xA4E4B66B68B65D60},
+    {0x36251260AB9D668E, 0xCE1DE40642E3F4B9}, {0xC1D72B7C6B426019, 0x80D2AE83E9CE78F3},
+    {0xB24CF65B8612F81F, 0xA1075A24E4421730}, {0xDEE033F26797B627, 0xC94930AE1D529CFC},
+    {0x169840EF017DA3B1, 0xFB9B7CD9A4A7443C}, {0x8E1F289560EE864E, 0x9D412E0806E88AA5},
+    {0xF1A6F2BAB92A27E2, 0xC491798A08A2AD4E}, {0xAE10AF696774B1DB, 0xF5B5D7EC8ACB58A2},
+    {0xACCA6DA1E0A8EF29, 0x9991A6F3D6BF1765}, {0x17FD090A58D32AF3, 0xBFF610B0CC6EDD3F},
+    {0xDDFC4B4CEF07F5B0, 0xEFF394DCFF8A948E}, {0x4ABDAF101564F98E, 0x95F83D0A1FB69CD9},
+    {0x9D6D1AD41ABE37F1, 0xBB764C4CA7A4440F}, {0x84C86189216DC5ED, 0xEA53DF5FD18D5513},
+    {0x32FD3CF5B4E49BB4, 0x92746B9BE2F8552C}, {0x3FBC8C33221DC2A1, 0xB7118682DBB66A77},
+    {0x0FABAF3FEAA5334A, 0xE4D5E82392A40515}, {0x29CB4D87F2A7400E, 0x8F05B1163BA6832D},
+    {0x743E20E9EF511012, 0xB2C71D5BCA9023F8}, {0x914DA9246B255416, 0xDF78E4B2BD342CF6},
+    {0x1AD089B6C2F7548E, 0x8BAB8EEFB6409C1A}, {0xA184AC2473B529B1, 0xAE9672ABA3D0C320},
+    {0xC9E5D72D90A2741E, 0xDA3C0F568CC4F3E8}, {0x7E2FA67C7A658892, 0x8865899617FB1871},
+    {0xDDBB901B98FEEAB7, 0xAA7EEBFB9DF9DE8D}, {0x552A74227F3EA565, 0xD51EA6FA85785631},
+    {0xD53A88958F87275F, 0x8533285C936B35DE}, {0x8A892ABAF368F137, 0xA67FF273B8460356},
+    {0x2D2B7569B0432D85, 0xD01FEF10A657842C}, {0x9C3B29620E29FC73, 0x8213F56A67F6B29B},
+    {0x8349F3BA91B47B8F, 0xA298F2C501F45F42}, {0x241C70A936219A73, 0xCB3F2F7642717713},
+    {0xED238CD383AA0110, 0xFE0EFB53D30DD4D7}, {0xF4363804324A40AA, 0x9EC95D1463E8A506},
+    {0xB143C6053EDCD0D5, 0xC67BB4597CE2CE48}, {0xDD94B7868E94050A, 0xF81AA16FDC1B81DA},
+    {0xCA7CF2B4191C8326, 0x9B10A4E5E9913128}, {0xFD1C2F611F63A3F0, 0xC1D4CE1F63F57D72},
+    {0xBC633B39673C8CEC, 0xF24A01A73CF2DCCF}, {0xD5BE0503E085D813, 0x976E41088617CA01},
+    {0x4B2D8644D8A74E18, 0xBD49D14AA79DBC82}, {0xDDF8E7D60ED1219E, 0xEC9C459D51852BA2},
+    {0xCABB90E5C942B503, 0x93E1AB8252F33B45}, {0x3D6A751F3B936243, 0xB8DA1662E7B00A17},
+    {0x0CC512670A783AD4, 0xE7109BFBA19C0C9D}, {0x27FB2B80668B24C5, 0x906A617D450187E2},
+    {0xB1F9F660802DEDF6, 0xB484F9DC9641E9DA}, {0x5E7873F8A0396973, 0xE1A63853BBD26451},
+    {0xDB0B487B6423E1E8, 0x8D07E33455637EB2}, {0x91CE1A9A3D2CDA62, 0xB049DC016ABC5E5F},
+    {0x7641A140CC7810FB, 0xDC5C5301C56B75F7}, {0xA9E904C87FCB0A9D, 0x89B9B3E11B6329BA},
+    {0x546345FA9FBDCD44, 0xAC2820D9623BF429}, {0xA97C177947AD4095, 0xD732290FBACAF133},
+    {0x49ED8EABCCCC485D, 0x867F59A9D4BED6C0}, {0x5C68F256BFFF5A74, 0xA81F301449EE8C70},
+    {0x73832EEC6FFF3111, 0xD226FC195C6A2F8C}, {0xC831FD53C5FF7EAB, 0x83585D8FD9C25DB7},
+    {0xBA3E7CA8B77F5E55, 0xA42E74F3D032F525}, {0x28CE1BD2E55F35EB, 0xCD3A1230C43FB26F},
+    {0x7980D163CF5B81B3, 0x80444B5E7AA7CF85}, {0xD7E105BCC332621F, 0xA0555E361951C366},
+    {0x8DD9472BF3FEFAA7, 0xC86AB5C39FA63440}, {0xB14F98F6F0FEB951, 0xFA856334878FC150},
+    {0x6ED1BF9A569F33D3, 0x9C935E00D4B9D8D2}, {0x0A862F80EC4700C8, 0xC3B8358109E84F07},
+    {0xCD27BB612758C0FA, 0xF4A642E14C6262C8}, {0x8038D51CB897789C, 0x98E7E9CCCFBD7DBD},
+    {0xE0470A63E6BD56C3, 0xBF21E44003ACDD2C}, {0x1858CCFCE06CAC74, 0xEEEA5D5004981478},
+    {0x0F37801E0C43EBC8, 0x95527A5202DF0CCB}, {0xD30560258F54E6BA, 0xBAA718E68396CFFD},
+    {0x47C6B82EF32A2069, 0xE950DF20247C83FD}, {0x4CDC331D57FA5441, 0x91D28B7416CDD27E},
+    {0xE0133FE4ADF8E952, 0xB6472E511C81471D}, {0x58180FDDD97723A6, 0xE3D8F9E563A198E5},
+    {0x570F09EAA7EA7648, 0x8E679C2F5E44FF8F}, {0x2CD2CC6551E513DA, 0xB201833B35D63F73},
+    {0xF8077F7EA65E58D1, 0xDE81E40A034BCF4F}, {0xFB04AFAF27FAF782, 0x8B112E86420F6191},
+    {0x79C5DB9AF1F9B563, 0xADD57A27D29339F6}, {0x18375281AE7822BC, 0xD94AD8B1C7380874},
+    {0x8F2293910D0B15B5, 0x87CEC76F1C830548}, {0xB2EB3875504DDB22, 0xA9C2794AE3A3C69A},
+    {0x5FA60692A46151EB, 0xD433179D9C8CB841}, {0xDBC7C41BA6BCD333, 0x849FEEC281D7F328},
+    {0x12B9B522906C0800, 0xA5C7EA73224DEFF3}, {0xD768226B34870A00, 0xCF39E50FEAE16BEF},
+    {0xE6A1158300D46640, 0x81842F29F2CCE375}, {0x60495AE3C1097FD0, 0xA1E53AF46F801C53},
+    {0x385BB19CB14BDFC4, 0xCA5E89B18B602368}, {0x46729E03DD9ED7B5, 0xFCF62C1DEE382C42},
+    {0x6C07A2C26A8346D1, 0x9E19DB92B4E31BA9}, {0xC7098B7305241885, 0xC5A05277621BE293},
+    {0xB8CBEE4FC66D1EA7, 0xF70867153AA2DB38}, {0x737F74F1DC043328, 0x9A65406D44A5C903},
+    {0x505F522E53053FF2, 0xC0FE908895CF3B44}, {0x647726B9E7C68FEF, 0xF13E34AABB430A15},
+    {0x5ECA783430DC19F5, 0x96C6E0EAB509E64D}, {0xB67D16413D132072, 0xBC789925624C5FE0},
+    {0xE41C5BD18C57E88F, 0xEB96BF6EBADF77D8}, {0x8E91B962F7B6F159, 0x933E37A534CBAAE7},
+    {0x723627BBB5A4ADB0, 0xB80DC58E81FE95A1}, {0xCEC3B1AAA30DD91C, 0xE61136F2227E3B09},
+    {0x213A4F0AA5E8A7B1, 0x8FCAC257558EE4E6}, {0xA988E2CD4F62D19D, 0xB3BD72ED2AF29E1F},
+    {0x93EB1B80A33B8605, 0xE0ACCFA875AF45A7}, {0xBC72F130660533C3, 0x8C6C01C9498D8B88},
+    {0xEB8FAD7C7F8680B4, 0xAF87023B9BF0EE6A}, {0xA67398DB9F6820E1, 0xDB68C2CA82ED2A05},
+    {0x88083F8943A1148C, 0x892179BE91D43A43}, {0x6A0A4F6B948959B0, 0xAB69D82E364948D4},
+    {0x848CE34679ABB01C, 0xD6444E39C3DB9B09}, {0xF2D80E0C0C0B4E11, 0x85EAB0E41A6940E5},
+    {0x6F8E118F0F0E2195, 0xA7655D1D2103911F}, {0x4B7195F2D2D1A9FB, 0xD13EB46469447567},
+};
+
+static const double _pow10_exact[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+inline static int _clz64(uint64_t v){
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanReverse64(&i, v);
+    return 63 - (int)i;
+#else
+    return __builtin_clzll(v);
+#endif
+}
+
+inline static uint64_t _mul128(uint64_t a, uint64_t b, uint64_t* hi){
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 r = (unsigned __int128)a * b;
+    *hi = (uint64_t)(r >> 64);
+    return (uint64_t)r;
+#elif defined(_MSC_VER) && defined(_M_X64)
+    return _umul128(a, b, hi);
+#else
+    uint64_t al = a & 0xFFFFFFFF, ah = a >> 32;
+    uint64_t bl = b & 0xFFFFFFFF, bh = b >> 32;
+    uint64_t ll = al * bl, lh = al * bh, hl = ah * bl, hh = ah * bh;
+    uint64_t mid = (ll >> 32) + (lh & 0xFFFFFFFF) + (hl & 0xFFFFFFFF);
+    *hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+    return (mid << 32) | (ll & 0xFFFFFFFF);
+#endif
+}
+
+#ifdef SOA_JSON_SWAR
+inline static int _is_8digits(const char* ptr){
+    uint64_t v;
+    memcpy(&v, ptr, 8);
+    return ((v & 0xF0F0F0F0F0F0F0F0ull) | 
+        (((v + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) == 0x3333333333333333ull;
+}
+
+inline static uint32_t _read_8digits(const char* ptr){
+    uint64_t v;
+    memcpy(&v, ptr, 8);
+    v -= 0x3030303030303030ull;
+    v = v * 10 + (v >> 8);
+    v = (((v & 0x000000FF000000FFull) * (100 + (1000000ull << 32))) +
+        (((v >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32)))) >> 32;
+    return (uint32_t)v;
+}
+#endif
+
+// Accumulates modulo 2^64, overflow is up to the caller
+inline static const char* _read_digits(const char* ptr, const char* end, uint64_t* mantissa){
+    uint64_t m = *mantissa;
+#ifdef SOA_JSON_SWAR
+    while(end - ptr >= 8 && _is_8digits(ptr)){
+        m = m * 100000000 + _read_8digits(ptr);
+        ptr += 8;
+    }
+#endif
+    while(ptr < end && _is_digit(*ptr)){
+        m = m * 10 + (*ptr - '0');
         ptr++;
     }
+    *mantissa = m;
     return ptr;
 }
 
-inline static int _strin(const char* str1, const char* str2){
-    while(*str1 && *str2){
-        if(*str1 != *str2){
+// Mantissa has to be non zero
+static int _eisel_lemire(uint64_t m, int64_t e10, int neg, double* out){
+    if(e10 < SOA_POW10_MIN || e10 > SOA_POW10_MAX){
+        return 0;
+    }
+    int lz = _clz64(m);
+    m <<= lz;
+    uint64_t exp2 = (uint64_t)(((217706 * e10) >> 16) + 64 + 1023) - lz;
+
+    const uint64_t* p = _pow10_128[e10 - SOA_POW10_MIN];
+    uint64_t hi;
+    uint64_t lo = _mul128(m, p[1], &hi);
+    if((hi & 0x1FF) == 0x1FF && lo + m < m){
+        // truncated power can still change the result, use the low half
+        uint64_t y_hi;
+        uint64_t y_lo = _mul128(m, p[0], &y_hi);
+        uint64_t merged_hi = hi;
+        uint64_t merged_lo = lo + y_hi;
+        if(merged_lo < lo){
+            merged_hi++;
+        }
+        if((merged_hi & 0x1FF) == 0x1FF && merged_lo + 1 == 0 && y_lo + m < m){
             return 0;
         }
-        str1++;
-        str2++;
+        hi = merged_hi;
+        lo = merged_lo;
+    }
+
+    uint64_t msb = hi >> 63;
+    uint64_t mantissa = hi >> (msb + 9);
+    exp2 -= 1 ^ msb;
+
+    // exactly halfway between two doubles
+    if(lo == 0 && (hi & 0x1FF) == 0 && (mantissa & 3) == 1){
+        return 0;
+    }
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if(mantissa >> 53){
+        mantissa >>= 1;
+        exp2++;
     }
+    // subnormal or infinite
+    if(exp2 - 1 >= 0x7FF - 1){
+        return 0;
+    }
+
+    uint64_t bits = exp2 << 52 | (mantissa & 0x000FFFFFFFFFFFFFull) | (uint64_t)neg << 63;
+    memcpy(out, &bits, sizeof(bits));
     return 1;
 }
 
-static const char* _parse_val(const char* ptr, _json_info_t* i);
-static const char* _read_val(const char* ptr, _json_info_t* i, _json_read_info_t* r);
+// Digits past the first 768 only decide whether a number lies exactly
+// between two doubles, so they are kept as one trailing nonzero digit when
+// any of them is. Rewritten as digits and an exponent without a decimal
+// point, strtod reads it the same in every locale and it fits the stack.
+#define _STRTOD_DIGITS 768
+
+static double _strtod_c(const char* start, const char* end){
+    char buf[_STRTOD_DIGITS + 32];
+    size_t n = 0;
+    const char* p = start;
+    if(p < end && *p == '-'){
+        buf[n++] = *p++;
+    }
 
-static uint64_t _atoull(const char* str){
-    while (_is_ws_char(*str))
-        ++str;
+    size_t digits = 0;
+    int64_t e10 = 0;
+    int frac = 0;
+    int sticky = 0;
+    for (; p < end && *p != 'e' && *p != 'E'; p++) {
+        if(*p == '.'){
+            frac = 1;
+        }
+        else if(!digits && *p == '0'){
+            e10 -= frac;
+        }
+        else if(digits < _STRTOD_DIGITS){
+            buf[n++] = *p;
+            digits++;
+            e10 -= frac;
+        }
+        else{
+            sticky |= *p != '0';
+            e10 += !frac;
+        }
+    }
+    if(!digits){
+        buf[n++] = '0';
+    }
+    if(sticky){
+        buf[n++] = '1';
+        e10--;
+    }
 
-    uint64_t prev = 0;    
-    uint64_t total = 0;
-	char c = *str++;
-    
-    while(c >= '0' && c <= '9'){
-        prev = total;
-        total = 10 * total + c - '0';
-        if(prev > total){
-            return ULONG_MAX;
+    if(p < end){
+        p++;
+        int neg = p < end && *p == '-';
+        p += p < end && (*p == '-' || *p == '+');
+        // far past where every double is 0 or infinite
+        int64_t x = 0;
+        for (; p < end && x < 100000000; p++) {
+            x = x * 10 + (*p - '0');
         }
-        c = *str++;
+        e10 += neg ? -x : x;
     }
+    snprintf(buf + n, sizeof(buf) - n, "e%lld", (long long)e10);
+    return strtod(buf, NULL);
+}
 
-    return total;
+static double _num_to_double(uint64_t m, int64_t e10, int neg, const char* start, const char* end){
+    if(m == 0){
+        return neg ? -0.0 : 0.0;
+    }
+#if FLT_EVAL_METHOD == 0
+    if(e10 >= -22 && e10 <= 22 && m <= (1ull << 53)){
+        double d = (double)m;
+        d = e10 < 0 ? d / _pow10_exact[-e10] : d * _pow10_exact[e10];
+        return neg ? -d : d;
+    }
+#endif
+    double d;
+    if(_eisel_lemire(m, e10, neg, &d)){
+        return d;
+    }
+    return _strtod_c(start, end);
 }
 
 static int _hexval(char c){
@@ -292,170 +1185,326 @@ static size_t _utf8_decode(const uint8_t* s, uint32_t* out){
     return 1;
 }
 
-static const char* _parse_num(const char* ptr, uint8_t* data){
-    uint8_t num_data = 0;
-    if(*ptr == '-'){
-        ptr++;
-        num_data |= 16;
+// Offset of the first byte that does not start a well formed sequence, n
+// when there is none. Overlongs, surrogates and code points past U+10FFFF
+// are rejected. ASCII is skipped 16 bytes at a time.
+#ifdef SOA_JSON_X86
+SOA_TARGET("sse2")
+#endif
+static size_t _utf8_check(const uint8_t* s, size_t n){
+    size_t i = 0;
+    while(i < n){
+#ifdef SOA_JSON_X86
+        if(n - i >= 16){
+            unsigned mask = (unsigned)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(s + i)));
+            if(!mask){
+                i += 16;
+                continue;
+            }
+            i += _ctz64(mask);
+        }
+#endif
+        uint8_t c = s[i];
+        if(c < 0x80){
+            i++;
+            continue;
+        }
+        size_t len;
+        uint8_t lo = 0x80, hi = 0xBF;
+        if(c >= 0xC2 && c <= 0xDF){
+            len = 2;
+        }
+        else if(c >= 0xE0 && c <= 0xEF){
+            len = 3;
+            lo = c == 0xE0 ? 0xA0 : lo;
+            hi = c == 0xED ? 0x9F : hi;
+        }
+        else if(c >= 0xF0 && c <= 0xF4){
+            len = 4;
+            lo = c == 0xF0 ? 0x90 : lo;
+            hi = c == 0xF4 ? 0x8F : hi;
+        }
+        else{
+            return i;
+        }
+        if(n - i < len || s[i + 1] < lo || s[i + 1] > hi){
+            return i;
+        }
+        for(size_t k = 2; k < len; k++){
+            if((s[i + k] & 0xC0) != 0x80){
+                return i;
+            }
+        }
+        i += len;
     }
-    else if(*ptr == '+'){
+    return n;
+}
+
+// Value can be NULL to only validate. Integers that do not fit 64 bits
+// become floats, or fail with SOA_JSON_STRICT_INT. Pushes its own errors.
+static const char* _parse_num(_json_index_t* x, const char* ptr, const char* end, soa_valu_t* value, uint8_t* type){
+    const char* start = ptr;
+    int neg = 0;
+    if(ptr < end && *ptr == '-'){
         ptr++;
+        neg = 1;
     }
-    while(_is_digit(*ptr)){
+    else if(ptr < end && *ptr == '+'){
         ptr++;
-        num_data |= 1;
     }
-    if(*ptr == '.'){
-        ptr++;
-        while(_is_digit(*ptr)){
-            ptr++;
-            num_data |= 2;
-        }
+
+    const char* digits = ptr;
+    uint64_t m = 0;
+    ptr = _read_digits(ptr, end, &m);
+    size_t count = ptr - digits;
+    int64_t e10 = 0;
+    int is_float = 0;
+    if(ptr < end && *ptr == '.'){
+        const char* frac = ++ptr;
+        ptr = _read_digits(ptr, end, &m);
+        count += ptr - frac;
+        e10 = -(int64_t)(ptr - frac);
+        is_float = 1;
     }
-    
-    if(*ptr == 'e' || *ptr == 'E'){
+    if(!count){
+        _json_error(x, "Value expected", 32, start - x->json);
+        return NULL;
+    }
+
+    if(ptr < end && (*ptr == 'e' || *ptr == 'E')){
         ptr++;
-        if(*ptr == '-' || *ptr == '+'){
+        int exp_neg = 0;
+        if(ptr < end && (*ptr == '-' || *ptr == '+')){
+            exp_neg = *ptr == '-';
             ptr++;
         }
-        while(_is_digit(*ptr)){
+        if(ptr == end || !_is_digit(*ptr)){
+            _json_error(x, "Value expected", 32, ptr - x->json);
+            return NULL;
+        }
+        int64_t exp = 0;
+        while(ptr < end && _is_digit(*ptr)){
+            // anything past this is zero or infinity anyway
+            if(exp < 0x10000){
+                exp = exp * 10 + (*ptr - '0');
+            }
             ptr++;
-            num_data |= 4;
         }
+        e10 += exp_neg ? -exp : exp;
+        is_float = 1;
     }
-    if(data){
-        *data = num_data;
+
+    // leading zeros do not count against the 19 digits the mantissa holds
+    size_t sig = count;
+    const char* first = digits;
+    if(count > 19){
+        while(first < ptr && (*first == '0' || *first == '.')){
+            sig -= *first == '0';
+            first++;
+        }
+    }
+
+    if(!is_float){
+        // 20 digits fit only below 18446744073709551616, a number starting
+        // with 1 wraps at most once and ends up under 10^19
+        int overflow = sig > 20 || 
+            (sig == 20 && (*first > '1' || m < 10000000000000000000ull)) ||
+            (neg && m > (uint64_t)INT64_MAX + 1);
+        if(!overflow){
+            if(value){
+                *type = neg ? SOA_TYPE_INT : SOA_TYPE_UINT;
+                if(neg){
+                    value->i = (int64_t)(0 - m);
+                }
+                else{
+                    value->u = m;
+                }
+            }
+            return ptr;
+        }
+        if(x->flags & SOA_JSON_STRICT_INT){
+            _json_error(x, "Integer out of range", 31, start - x->json);
+            return NULL;
+        }
     }
-    if(num_data){
-        return ptr;
+
+    if(value){
+        *type = SOA_TYPE_FLOAT;
+        value->f = sig > 19 ? _strtod_c(start, ptr) : _num_to_double(m, e10, neg, start, ptr);
     }
-    return NULL;
+    return ptr;
 }
 
-static const char* _parse_num_or_bool(const char* ptr, _json_info_t* i){
-    if(_strin(ptr, "null")){
-        return ptr + 4;
-    }
-    else if(_strin(ptr, "false")){
-        return ptr + 5;
+inline static int _is_literal(const char* ptr, const char* end, const char* lit, size_t len){
+    return (size_t)(end - ptr) >= len && memcmp(ptr, lit, len) == 0;
+}
+
+// Only whitespace may follow a scalar before the next structural character
+inline static int _scalar_end(const char* ptr, const char* end){
+    while(ptr < end && _is_ws_char(*ptr)){
+        ptr++;
     }
-    else if(_strin(ptr, "true")){
-        return ptr + 4;
+    return ptr == end;
+}
 
+static int _parse_num_or_bool(_json_index_t* x, _json_info_t* i){
+    const char* ptr = x->json + _tok_pos(x);
+    const char* end = x->json + x->pos[x->t + 1];
+    x->t++;
+
+    if(_is_literal(ptr, end, "null", 4) || _is_literal(ptr, end, "true", 4)){
+        ptr += 4;
     }
-    else if((ptr = _parse_num(ptr, NULL))){
-        return ptr;
+    else if(_is_literal(ptr, end, "false", 5)){
+        ptr += 5;
     }
-    else{
-        return NULL;
+    else if(!(ptr = _parse_num(x, ptr, end, NULL, NULL))){
+        return 0;
+    }
+    if(!_scalar_end(ptr, end)){
+        return _json_error(x, "Value expected", 32, ptr - x->json);
     }
-    return ++ptr;
+    return 1;
 }
 
-static const char* _read_num_or_bool(const char* ptr, _json_info_t* i, _json_read_info_t* r, uint8_t* t){
-    if(_strin(ptr, "null")){
+// Validates the scalar as well, so the single pass builder can use it
+static int _read_num_or_bool(_json_index_t* x, uint8_t* value, uint8_t* t){
+    const char* ptr = x->json + _tok_pos(x);
+    const char* end = x->json + x->pos[x->t + 1];
+    x->t++;
+
+    if(_is_literal(ptr, end, "null", 4)){
         *t = SOA_TYPE_BOOL;
-        *(soa_bool_t*)r->ptr = SOA_BOOL_NULL;
-        return ptr + 4;
+        *(soa_bool_t*)value = SOA_BOOL_NULL;
+        ptr += 4;
     }
-    else if(_strin(ptr, "false")){
+    else if(_is_literal(ptr, end, "false", 5)){
         *t = SOA_TYPE_BOOL;
-        *(soa_bool_t*)r->ptr = SOA_BOOL_FALSE;
-        return ptr + 5;
+        *(soa_bool_t*)value = SOA_BOOL_FALSE;
+        ptr += 5;
     }
-    else if(_strin(ptr, "true")){
+    else if(_is_literal(ptr, end, "true", 4)){
         *t = SOA_TYPE_BOOL;
-        *(soa_bool_t*)r->ptr = SOA_BOOL_TRUE;
-        return ptr + 4;
+        *(soa_bool_t*)value = SOA_BOOL_TRUE;
+        ptr += 4;
     }
-    else{
-        uint8_t num_data;
-        const char* start = ptr;
-        if((ptr = _parse_num(ptr, &num_data))){
-            if(num_data & 16 && (num_data & 2) == 0) {
-                // neg int
-                *t = SOA_TYPE_INT;
-                *(int64_t*)r->ptr = atoll(start);
-            }
-            else if((num_data & 16) == 0 && (num_data & 2) == 0) {
-                // pos int
-                *t = SOA_TYPE_UINT;
-                *(uint64_t*)r->ptr = _atoull(start);
-            }
-            else if(num_data & 2 || num_data & 4) {
-                // double
-                *t = SOA_TYPE_FLOAT;
-                *(double*)r->ptr = atof(start);
-            }
-            return ptr;
-        }
-        return NULL;
+    else if(!(ptr = _parse_num(x, ptr, end, (soa_valu_t*)value, t))){
+        return 0;
+    }
+    if(!_scalar_end(ptr, end)){
+        return _json_error(x, "Value expected", 32, ptr - x->json);
     }
-    return ++ptr;
+    return 1;
 }
 
-static const char* _parse_str(const char* ptr, _json_info_t* i){
-    ptr++;
-    const char* start = ptr;
-    while(*ptr != '"'){
-        if(!*ptr){
-            soa_error_push("String not terminated properly!", 21);
-            return NULL;
-        }
-        if(*ptr == '\\'){
-            ptr++;
-            if(!*ptr){
-                break;
-            }
-        }
-        ptr++;
+// Opening and closing quote are consecutive tokens
+// Long strings are prefixed with their length and marks
+inline static size_t _str_set_len(char* str, size_t len, size_t marks){
+    size_t word = len | marks;
+    memcpy(str - sizeof(size_t), &word, sizeof(size_t));
+    return len;
+}
+
+// Inline strings are zero filled and keep 7 - length in the last byte
+inline static size_t _sso_set_len(char* sso, size_t len){
+    sso[7] = (char)(7 - len);
+    return len;
+}
+
+// Long strings without escapes point into the input in insitu mode
+inline static int _str_borrow(const _json_index_t* x, const char* start, size_t n){
+    return (x->flags & SOA_JSON_INSITU) && n > 7 && !memchr(start, '\\', n);
+}
+
+inline static uint8_t _str_type(uint8_t sso){
+    return sso == SOA_KEY_REF ? SOA_TYPE_REF : sso == SOA_KEY_SSO ? SOA_TYPE_SSO : SOA_TYPE_STR;
+}
+
+// Checks the string at the current token with SOA_JSON_VALIDATE_UTF
+inline static int _str_check(_json_index_t* x){
+    if(!(x->flags & SOA_JSON_VALIDATE_UTF)){
+        return 1;
+    }
+    size_t start = x->pos[x->t] + 1;
+    size_t n = x->pos[x->t + 1] - start;
+    size_t bad = _utf8_check((const uint8_t*)x->json + start, n);
+    if(bad < n){
+        return _json_error(x, "Invalid UTF-8 in string", 22, start + bad);
+    }
+    return 1;
+}
+
+static int _parse_str(_json_index_t* x, _json_info_t* i){
+    size_t start = x->pos[x->t] + 1;
+    size_t end = x->pos[x->t + 1];
+    if(end >= x->len){
+        return _json_error(x, "String not terminated properly!", 21, start - 1);
+    }
+    if(!_str_check(x)){
+        return 0;
     }
+    x->t += 2;
 
     // sso
-    if(ptr - start + 1> 8){
+    if(end - start + 1 > 8 && !_str_borrow(x, x->json + start, end - start)){
         i->str++;
-        i->str_size += ptr - start + 1; // null terminator
+        i->str_size += sizeof(size_t) + end - start + 1; // length and null terminator
     }
 
-    return ++ptr;
+    return 1;
 }
 
-static const char* _read_str(const char* ptr, _json_info_t* i, _json_read_info_t* r, uint8_t* sso){
-    ptr++;
-    const char* start = ptr;
-    while(*ptr && *ptr != '"'){
-        if(*ptr == '\\'){
-            ptr++;
+// Bit 1 for bytes printed escaped, bit 2 for bytes that are not ASCII
+inline static unsigned _escape_class(uint8_t c){
+    return (c < 0x20 || c == '"' || c == '\\' || c == '/') | (c >= 0x7F) << 1;
+}
+
+// Length of the run before the next backslash, seen gets the escape
+// classes of its bytes
+#ifdef SOA_JSON_X86
+SOA_TARGET("sse2")
+#endif
+static size_t _unescape_run(const char* s, size_t n, unsigned* seen){
+    size_t i = 0;
+#ifdef SOA_JSON_X86
+    for(; n - i >= 16; i += 16){
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+        unsigned bs = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+        __m128i esc = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')), _mm_cmpeq_epi8(v, _mm_set1_epi8('/'))),
+            _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(0x1F)), v)
+        );
+        unsigned wide = (unsigned)_mm_movemask_epi8(v) | (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(0x7F)));
+        unsigned before = bs ? (1u << _ctz64(bs)) - 1 : 0xFFFF;
+        *seen |= ((unsigned)_mm_movemask_epi8(esc) & before ? 1 : 0) | (wide & before ? 2 : 0);
+        if(bs){
+            return i + _ctz64(bs);
         }
-        ptr++;
-    }
-    
-    size_t len = ptr - start + 1;
-    char* new_str = 0;
-    if(len > 8){
-        *(size_t*)r->ptr = r->s_offset;
-        new_str = (char*)r->data + r->s_offset;
-        r->s_offset += len;
-        *sso = 0;
     }
-    else{
-        new_str = (char*)r->ptr;
-        *sso = 1;
+#endif
+    for(; i < n && s[i] != '\\'; i++){
+        *seen |= _escape_class((uint8_t)s[i]);
     }
+    return i;
+}
 
-    memcpy(new_str, start, len);
-    *(new_str + len - 1) = 0;
-
-    char* ns = new_str;
-    char* ds = new_str;
-    while(*ns){
-        if (*ns != '\\') {
-            *ds++ = *ns++;
-            continue;
-        }
-        
+// Unescapes n raw bytes into dst, dst gets a null terminator and can be
+// the same memory as src. Marks get the _SOA_STR_* bits that hold.
+static size_t _unescape(char* dst, const char* src, size_t n, size_t* marks){
+    const char* ns = src;
+    const char* end = src + n;
+    char* ds = dst;
+    unsigned seen = 0;
+    while(ns < end){
+        size_t run = _unescape_run(ns, end - ns, &seen);
+        memmove(ds, ns, run);
+        ds += run;
+        ns += run;
+        if(ns == end) break;
+
+        seen |= 1;
         ns++;
-        if(!*ns) break;
+        if(ns == end) break;
 
         switch(*ns){
             case '"':
@@ -491,14 +1540,14 @@ static const char* _read_str(const char* ptr, _json_info_t* i, _json_read_info_t
                 ns++; 
                 break;
             case 'u':
-                int u1 = _read_u4(ns + 1);
+                int u1 = end - ns > 4 ? _read_u4(ns + 1) : -1;
                 if (u1 < 0) { *ds++ = '?'; ns++; break; }
                 ns += 5;
 
                 uint32_t cp = u1;
 
                 /* Surrogate pair */
-                if (u1 >= 0xD800 && u1 <= 0xDBFF && ns[0] == '\\' && ns[1] == 'u') {
+                if (u1 >= 0xD800 && u1 <= 0xDBFF && end - ns > 5 && ns[0] == '\\' && ns[1] == 'u') {
                     int u2 = _read_u4(ns + 2);
                     if (u2 >= 0xDC00 && u2 <= 0xDFFF) {
                         cp = 0x10000 + (((u1 - 0xD800) << 10)
@@ -515,92 +1564,127 @@ static const char* _read_str(const char* ptr, _json_info_t* i, _json_read_info_t
         }
     }
     *ds = '\0';
-
-    return ++ptr;
+    *marks = (seen & 1 ? 0 : _SOA_STR_CLEAN) | (seen & 2 ? 0 : _SOA_STR_ASCII);
+    return ds - dst;
 }
 
-static const char* _parse_obj(const char* ptr, _json_info_t* i){
-    ptr = _skip_ws(++ptr);
+// Sso gets a soa_key_bit_t, returns unescaped length
+static size_t _read_str(_json_index_t* x, _json_info_t* i, _json_read_info_t* r, uint8_t* sso, const char** str){
+    const char* start = x->json + x->pos[x->t] + 1;
+    size_t len = x->pos[x->t + 1] - x->pos[x->t];
+    x->t += 2;
 
-    size_t index =_info_add_obj(i);
-    size_t size = 0;
-    if(!i->root_type){
-        i->root_type = SOA_ROOT_OBJ;
+    char* new_str = 0;
+    if(_str_borrow(x, start, len - 1)){
+        ((soa_valu_t*)r->ptr)->r = (soa_ref_t){(uint32_t)(start - x->json), (uint32_t)(len - 1)};
+        *sso = SOA_KEY_REF;
+        *str = start;
+        return len - 1;
     }
-    while(*ptr != '}'){
-        if(!*ptr){
-            soa_error_push("Object not terminated properly!", 11);
-            return NULL;
-        }
+    if(len > 8){
+        *(size_t*)r->ptr = r->s_offset + sizeof(size_t);
+        new_str = (char*)r->data + r->s_offset + sizeof(size_t);
+        r->s_offset += sizeof(size_t) + len;
+        *sso = SOA_KEY_STR;
+        *str = new_str;
+        size_t marks;
+        size_t n = _unescape(new_str, start, len - 1, &marks);
+        return _str_set_len(new_str, n, marks);
+    }
+    new_str = (char*)r->ptr;
+    memset(new_str, 0, 8);
+    *sso = SOA_KEY_SSO;
+    *str = new_str;
+    size_t marks;
+    return _sso_set_len(new_str, _unescape(new_str, start, len - 1, &marks));
+}
 
+static int _parse_obj(_json_index_t* x, _json_info_t* i){
+    x->t++;
+
+    size_t index =_info_add_obj(i);
+    size_t size = 0;
+    if(!i->root_type){
+        i->root_type = SOA_ROOT_OBJ;
+    }
+    if(_tok(x) == '}'){
+        x->t++;
+        i->osizes[index] = 0;
+        return 1;
+    }
+    while(1){
         // key
-        ptr = _parse_str(ptr, i);
-        if(!ptr){
-            return NULL;
+        if(_tok(x) != '"'){
+            return _json_error(x, "Invalid key: pair!!", 12, _tok_pos(x));
         }
-        ptr = _skip_ws(ptr);
-        if(*ptr != ':'){
-            soa_error_push("Invalid key: pair!!", 12);
-            return NULL;
+        if(!_parse_str(x, i)){
+            return 0;
+        }
+        if(_tok(x) != ':'){
+            return _json_error(x, "Invalid key: pair!!", 12, _tok_pos(x));
         }
-        ptr = _skip_ws(++ptr);
+        x->t++;
 
         // value
-        ptr = _parse_val(ptr, i);
-        if(!ptr){
-            return NULL;
+        if(!_parse_val(x, i)){
+            return 0;
         }
-        ptr = _skip_ws(ptr);
         
         i->oe++;
         size++;
-        if(*ptr == ','){
-            ptr = _skip_ws(++ptr);
+
+        char c = _tok(x);
+        x->t++;
+        if(c == '}'){
+            break;
+        }
+        if(c != ','){
+            return _json_error(x, "Object not terminated properly!", 11, x->pos[x->t - 1]);
         }
     }
     i->osizes[index] = size;
-    return ++ptr;
+    return 1;
 }
 
-static const char* _read_obj(const char* ptr, _json_info_t* i, _json_read_info_t* r){
-    ptr = _skip_ws(++ptr);
+static void _read_obj(_json_index_t* x, _json_info_t* i, _json_read_info_t* r){
+    x->t++;
 
     *(size_t*)r->ptr = r->o_offset;
     
     r->ptr = r->data + r->o_offset;
-    memcpy(r->ptr, i->osizes + r->o, sizeof(size_t));
-    r->ptr += sizeof(size_t);
-    r->o_offset += i->osizes[r->o] * sizeof(soa_obj_entry_t) + sizeof(size_t);
+    *(soa_obj_header_t*)r->ptr = (soa_obj_header_t){.length = i->osizes[r->o]};
+    r->ptr += sizeof(soa_obj_header_t);
+    r->o_offset += i->osizes[r->o] * sizeof(soa_obj_entry_t) + sizeof(soa_obj_header_t);
     r->o++;
     
-    while(*ptr != '}'){
+    while(_tok(x) != '}'){
         // key
         uint8_t* old = r->ptr;
-        r->ptr += 2 * sizeof(size_t);
+        soa_obj_entry_t* e = (soa_obj_entry_t*)old;
+        r->ptr += offsetof(soa_obj_entry_t, key);
         uint8_t sso;
-        ptr = _read_str(ptr, i, r, &sso);
-        r->ptr += -sizeof(size_t) + sizeof(uint8_t);
-        *r->ptr = sso;
-        r->ptr += -sizeof(size_t) - sizeof(uint8_t);
-        ptr = _skip_ws(ptr);
-        ptr = _skip_ws(++ptr);
+        const char* key;
+        size_t len = _read_str(x, i, r, &sso, &key);
+        e->sso = sso;
+        e->hash = soa_key_hash(key, len);
+        r->ptr = old;
+        x->t++;
 
         // value
-        ptr = _read_val(ptr, i, r);
+        _read_val(x, i, r);
         r->ptr = old;
-        ptr = _skip_ws(ptr);
         
-        if(*ptr == ','){
-            ptr = _skip_ws(++ptr);
+        if(_tok(x) == ','){
+            x->t++;
         }
 
         r->ptr += sizeof(soa_obj_entry_t);
     }
-    return ++ptr;
+    x->t++;
 }
 
-static const char* _parse_arr(const char* ptr, _json_info_t* i){
-    ptr = _skip_ws(++ptr);
+static int _parse_arr(_json_index_t* x, _json_info_t* i){
+    x->t++;
 
     size_t index = _info_add_arr(i);
     size_t size = 0;
@@ -608,224 +1692,1483 @@ static const char* _parse_arr(const char* ptr, _json_info_t* i){
     if(!i->root_type){
         i->root_type = SOA_ROOT_ARR;
     }
-    while(*ptr != ']'){
-        if(!*ptr){
-            soa_error_push("Array not terminated properly!", 01);
-            return NULL;
+    if(_tok(x) == ']'){
+        x->t++;
+        i->asizes[index] = 0;
+        return 1;
+    }
+    while(1){
+        if(!_parse_val(x, i)){
+            return 0;
         }
-        ptr = _parse_val(ptr, i);
-        if(!ptr){
-            return NULL;
+        i->ae++;
+        size++;
+
+        char c = _tok(x);
+        x->t++;
+        if(c == ']'){
+            break;
+        }
+        if(c != ','){
+            return _json_error(x, "Array not terminated properly!", 01, x->pos[x->t - 1]);
+        }
+    }
+    i->asizes[index] = size;
+    return 1;
+}
+
+static void _read_arr(_json_index_t* x, _json_info_t* i, _json_read_info_t* r){
+    x->t++;
+
+    *(size_t*)r->ptr = r->a_offset;
+
+    r->ptr = r->data + r->a_offset;
+    memcpy(r->ptr, i->asizes + r->a, sizeof(size_t));
+    r->ptr += sizeof(size_t); 
+    r->a_offset += i->asizes[r->a] * sizeof(soa_arr_entry_t) + sizeof(size_t);
+    r->a++;
+
+    while(_tok(x) != ']'){
+        uint8_t* old = r->ptr;
+        _read_val(x, i, r);
+        r->ptr = old;
+        if(_tok(x) == ','){
+            x->t++;
+        }
+        r->ptr += sizeof(soa_arr_entry_t);
+    }
+    x->t++;
+}
+
+static int _parse_val(_json_index_t* x, _json_info_t* i){
+    switch(_tok(x)){
+    case '[':
+        return _parse_arr(x, i);
+    case '{':
+        return _parse_obj(x, i);
+    case '"':
+        return _parse_str(x, i);
+    case ']':
+    case '}':
+    case ':':
+    case ',':
+    case 0:
+        break;
+    default:
+        return _parse_num_or_bool(x, i);
+    }
+    return _json_error(x, "Value expected", 32, _tok_pos(x));
+} 
+
+static void _read_val(_json_index_t* x, _json_info_t* i, _json_read_info_t* r){
+    uint8_t* type = (r->ptr + sizeof(soa_valu_t));
+
+    switch(_tok(x)){
+    case '[':
+        _read_arr(x, i, r);
+        *type = SOA_TYPE_ARR; 
+        break;
+    case '{':
+        _read_obj(x, i, r);
+        *type = SOA_TYPE_OBJ; 
+        break;
+    case '"':{
+        uint8_t sso;
+        const char* str;
+        _read_str(x, i, r, &sso, &str);
+        *type = _str_type(sso); 
+        break;    
+    }
+    default:
+        _read_num_or_bool(x, r->ptr, type);
+    }
+}
+
+// Single pass builder
+//
+// Entries of open containers are collected on a scratch stack. When a
+// container closes its size is known, so it is copied into the doc in one
+// piece and its offset is written into the parent entry. Long strings go
+// straight into the doc, containers end up in post order.
+
+typedef struct {
+    size_t start;
+    size_t count;
+    uint8_t type;
+} _json_frame_t;
+
+typedef enum {
+    _JSON_BUILD_VALUE = 0,
+    _JSON_BUILD_KEY,
+    _JSON_BUILD_NEXT,
+    _JSON_BUILD_DONE
+} _json_build_state_t;
+
+typedef struct {
+    uint8_t* entries;
+    size_t size;
+    size_t cap;
+
+    _json_frame_t* frames;
+    size_t depth;
+    size_t fcap;
+
+    soa_obj_entry_t root;
+    _json_build_state_t state;
+    const soa_allocator_t* alloc;
+} _json_tape_t;
+
+static _json_tape_t _tape_new(size_t prealloc, const soa_allocator_t* alloc){
+    _json_tape_t tp = {.alloc = alloc};
+
+    tp.cap = prealloc * sizeof(soa_obj_entry_t);
+    tp.entries = _soa_alloc(alloc, tp.cap);
+
+    tp.fcap = prealloc;
+    tp.frames = _soa_alloc(alloc, prealloc * sizeof(_json_frame_t));
+
+    return tp;
+}
+
+inline static void _tape_free(_json_tape_t* tp){
+    if(tp->entries)
+        _soa_free(tp->alloc, tp->entries, tp->cap);
+    if(tp->frames)
+        _soa_free(tp->alloc, tp->frames, tp->fcap * sizeof(_json_frame_t));
+}
+
+inline static size_t _entry_size(uint8_t type){
+    return type == SOA_TYPE_OBJ ? sizeof(soa_obj_entry_t) : sizeof(soa_arr_entry_t);
+}
+
+// New zeroed entry in the innermost container
+static uint8_t* _tape_push_entry(_json_tape_t* tp){
+    _json_frame_t* f = tp->frames + tp->depth - 1;
+    size_t size = _entry_size(f->type);
+    if(tp->size + size > tp->cap){
+        size_t cap = (tp->size + size) * 2;
+        tp->entries = _soa_realloc(tp->alloc, tp->entries, tp->cap, cap);
+        tp->cap = cap;
+    }
+    uint8_t* e = tp->entries + tp->size;
+    memset(e, 0, size);
+    tp->size += size;
+    f->count++;
+    return e;
+}
+
+// Entry the next value is written to
+inline static uint8_t* _tape_slot(_json_tape_t* tp){
+    if(!tp->depth){
+        return (uint8_t*)&tp->root;
+    }
+    return tp->entries + tp->size - _entry_size(tp->frames[tp->depth - 1].type);
+}
+
+static void _tape_open(_json_tape_t* tp, uint8_t type){
+    if(tp->depth == tp->fcap){
+        tp->frames = _soa_realloc(tp->alloc, tp->frames, tp->fcap * sizeof(_json_frame_t), tp->fcap * 2 * sizeof(_json_frame_t));
+        tp->fcap *= 2;
+    }
+    tp->frames[tp->depth++] = (_json_frame_t){tp->size, 0, type};
+}
+
+static void _tape_close(_json_tape_t* tp, soa_doc_t* doc){
+    _json_frame_t f = tp->frames[--tp->depth];
+    size_t bytes = tp->size - f.start;
+
+    // strings before it can leave the doc unaligned
+    size_t pad = (sizeof(size_t) - doc->size % sizeof(size_t)) % sizeof(size_t);
+    size_t header = f.type == SOA_TYPE_OBJ ? sizeof(soa_obj_header_t) : sizeof(size_t);
+    uint8_t* block = _soa_doc_grow(doc, pad + header + bytes) + pad;
+    if(f.type == SOA_TYPE_OBJ){
+        *(soa_obj_header_t*)block = (soa_obj_header_t){.length = f.count};
+    }
+    else{
+        *(size_t*)block = f.count;
+    }
+    memcpy(block + header, tp->entries + f.start, bytes);
+    tp->size = f.start;
+
+    uint8_t* slot = _tape_slot(tp);
+    *(size_t*)slot = block - doc->data;
+    slot[sizeof(soa_valu_t)] = f.type;
+}
+
+// Slot has to be zeroed, sso gets a soa_key_bit_t, returns unescaped length
+static size_t _build_str(_json_index_t* x, soa_doc_t* doc, uint8_t* slot, uint8_t* sso, const char** str){
+    const char* start = x->json + x->pos[x->t] + 1;
+    size_t len = x->pos[x->t + 1] - x->pos[x->t];
+    x->t += 2;
+
+    if(_str_borrow(x, start, len - 1)){
+        ((soa_valu_t*)slot)->r = (soa_ref_t){(uint32_t)(start - x->json), (uint32_t)(len - 1)};
+        *sso = SOA_KEY_REF;
+        *str = start;
+        return len - 1;
+    }
+    if(len > 8){
+        char* new_str = (char*)_soa_doc_grow(doc, sizeof(size_t) + len) + sizeof(size_t);
+        *(size_t*)slot = (uint8_t*)new_str - doc->data;
+        *sso = SOA_KEY_STR;
+        *str = new_str;
+        size_t marks;
+        size_t n = _unescape(new_str, start, len - 1, &marks);
+        return _str_set_len(new_str, n, marks);
+    }
+    *sso = SOA_KEY_SSO;
+    *str = (char*)slot;
+    size_t marks;
+    return _sso_set_len((char*)slot, _unescape((char*)slot, start, len - 1, &marks));
+}
+
+// Returns 0 on error and 2 when it stopped for more input
+static int _build(_json_index_t* x, _json_tape_t* tp, soa_doc_t* doc){
+    while(tp->state != _JSON_BUILD_DONE){
+        // a key reads up to its colon, the most any state looks ahead
+        if(x->more && x->t + 2 >= x->count){
+            return 2;
+        }
+        char c = _tok(x);
+
+        switch(tp->state){
+        case _JSON_BUILD_VALUE:{
+            uint8_t* slot = _tape_slot(tp);
+            switch(c){
+            case '[':
+            case '{':
+                if(!tp->depth && !doc->root_type){
+                    doc->root_type = c == '[' ? SOA_ROOT_ARR : SOA_ROOT_OBJ;
+                }
+                _tape_open(tp, c == '[' ? SOA_TYPE_ARR : SOA_TYPE_OBJ);
+                x->t++;
+                if(_tok(x) == (c == '[' ? ']' : '}')){
+                    x->t++;
+                    _tape_close(tp, doc);
+                    tp->state = _JSON_BUILD_NEXT;
+                }
+                else if(c == '['){
+                    _tape_push_entry(tp);
+                }
+                else{
+                    tp->state = _JSON_BUILD_KEY;
+                }
+                continue;
+            case '"':{
+                if(x->pos[x->t + 1] >= x->len){
+                    return _json_error(x, "String not terminated properly!", 21, _tok_pos(x));
+                }
+                if(!_str_check(x)){
+                    return 0;
+                }
+                uint8_t sso;
+                const char* str;
+                _build_str(x, doc, slot, &sso, &str);
+                slot[sizeof(soa_valu_t)] = _str_type(sso);
+                break;
+            }
+            case ']':
+            case '}':
+            case ':':
+            case ',':
+            case 0:
+                return _json_error(x, "Value expected", 32, _tok_pos(x));
+            default:
+                if(!_read_num_or_bool(x, slot, slot + sizeof(soa_valu_t))){
+                    return 0;
+                }
+            }
+            tp->state = _JSON_BUILD_NEXT;
+            break;
+        }
+        case _JSON_BUILD_KEY:{
+            if(c != '"'){
+                return _json_error(x, "Invalid key: pair!!", 12, _tok_pos(x));
+            }
+            if(x->pos[x->t + 1] >= x->len){
+                return _json_error(x, "String not terminated properly!", 21, _tok_pos(x));
+            }
+            if(!_str_check(x)){
+                return 0;
+            }
+            soa_obj_entry_t* e = (soa_obj_entry_t*)_tape_push_entry(tp);
+            const char* key;
+            size_t len = _build_str(x, doc, (uint8_t*)&e->key, &e->sso, &key);
+            e->hash = soa_key_hash(key, len);
+            if(_tok(x) != ':'){
+                return _json_error(x, "Invalid key: pair!!", 12, _tok_pos(x));
+            }
+            x->t++;
+            tp->state = _JSON_BUILD_VALUE;
+            break;
+        }
+        case _JSON_BUILD_NEXT:{
+            if(!tp->depth){
+                tp->state = _JSON_BUILD_DONE;
+                break;
+            }
+            uint8_t type = tp->frames[tp->depth - 1].type;
+            x->t++;
+            if(c == ','){
+                if(type == SOA_TYPE_ARR){
+                    _tape_push_entry(tp);
+                    tp->state = _JSON_BUILD_VALUE;
+                }
+                else{
+                    tp->state = _JSON_BUILD_KEY;
+                }
+            }
+            else if((c == ']' && type == SOA_TYPE_ARR) || (c == '}' && type == SOA_TYPE_OBJ)){
+                _tape_close(tp, doc);
+            }
+            else{
+                if(type == SOA_TYPE_ARR){
+                    return _json_error(x, "Array not terminated properly!", 01, x->pos[x->t - 1]);
+                }
+                return _json_error(x, "Object not terminated properly!", 11, x->pos[x->t - 1]);
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    return 1;
+}
+
+// Empties doc and makes room for size bytes, keeping its buffer when it fits
+static void _doc_reset(soa_doc_t* doc, size_t size){
+    if(doc->mapped || doc->cap < size){
+        const soa_allocator_t* alloc = doc->alloc;
+        soa_doc_free(doc);
+        doc->alloc = alloc;
+        doc->data = _soa_alloc(alloc, size);
+        doc->cap = size;
+    }
+    doc->size = 0;
+    doc->root = 0;
+    doc->root_type = SOA_ROOT_NULL;
+    doc->source = NULL;
+}
+
+static int _parse_single_pass(_json_index_t* x, _json_tape_t* tp, soa_doc_t* doc, const char* json, size_t len){
+    tp->size = 0;
+    tp->depth = 0;
+    tp->root = (soa_obj_entry_t){0};
+    tp->state = _JSON_BUILD_VALUE;
+
+    if(!_index_build(x, json, len)){
+        return 0;
+    }
+
+    // every value starts with at least one token and no string gets
+    // longer than its text, so this is enough in almost every case
+    _doc_reset(doc, x->count * sizeof(soa_arr_entry_t) + len);
+    if(x->flags & SOA_JSON_INSITU){
+        doc->source = json;
+    }
+
+    if(!_build(x, tp, doc) || !doc->root_type){
+        doc->size = 0;
+        doc->root_type = SOA_ROOT_NULL;
+        return 0;
+    }
+    doc->root = *(size_t*)&tp->root;
+    return 1;
+}
+
+static int _parse_two_pass(_json_index_t* x, _json_info_t* i, soa_doc_t* doc, const char* json, size_t len){
+    i->ae = i->ao = i->oe = i->oo = 0;
+    i->str = i->str_size = 0;
+    i->root_type = SOA_ROOT_NULL;
+
+    if(!_index_build(x, json, len) || !_parse_val(x, i) || !i->root_type){
+        return 0;
+    }
+    
+    size_t size =
+    i->ao * sizeof(size_t) + 
+    i->oo * sizeof(soa_obj_header_t) + 
+    i->ae * sizeof(soa_arr_entry_t) +
+    i->oe * sizeof(soa_obj_entry_t) +
+    i->str_size;
+    _doc_reset(doc, size);
+    doc->size = size;
+    doc->root_type = i->root_type;
+    if(x->flags & SOA_JSON_INSITU){
+        doc->source = json;
+    }
+
+    // root is written into a scratch entry, containers start at their offsets
+    soa_obj_entry_t root;
+    _json_read_info_t r = {
+        0, 0, 
+        0, i->ao * sizeof(size_t) + i->ae * sizeof(soa_arr_entry_t), 
+        i->ao * sizeof(size_t) + i->oo * sizeof(soa_obj_header_t) + i->ae * sizeof(soa_arr_entry_t) + i->oe * sizeof(soa_obj_entry_t), 
+        doc->data, (uint8_t*)&root
+    };
+    x->t = 0;
+    if(i->root_type == SOA_ROOT_ARR){
+        _read_arr(x, i, &r);
+        doc->root = 0;
+    }
+    else{
+        _read_obj(x, i, &r);
+        doc->root = i->ao * sizeof(size_t) + i->ae * sizeof(soa_arr_entry_t);
+    }
+    return 1;
+}
+
+static soa_doc_t _doc_new_single_pass(const char* json, size_t len, soa_json_parse_flags_t flags, const soa_allocator_t* alloc, soa_error_t* error){
+    _json_index_t x = {.flags = flags, .alloc = alloc};
+    _json_tape_t tp = _tape_new(SOA_JSON_PREALLOC, alloc);
+    soa_doc_t doc = soa_doc_new();
+    doc.alloc = alloc;
+
+    if(!_parse_single_pass(&x, &tp, &doc, json, len)){
+        soa_doc_free(&doc);
+        doc.alloc = alloc;
+    }
+
+    *error = x.error;
+    _index_free(&x);
+    _tape_free(&tp);
+    return doc;
+}
+
+static soa_doc_t _doc_new_two_pass(const char* json, size_t len, soa_json_parse_flags_t flags, const soa_allocator_t* alloc, soa_error_t* error){
+    _json_info_t i = _info_new(SOA_JSON_PREALLOC, alloc);
+    _json_index_t x = {.flags = flags, .alloc = alloc};
+    soa_doc_t doc = soa_doc_new();
+    doc.alloc = alloc;
+
+    if(!_parse_two_pass(&x, &i, &doc, json, len)){
+        soa_doc_free(&doc);
+        doc.alloc = alloc;
+    }
+
+    *error = x.error;
+    _index_free(&x);
+    _info_free(&i);
+    return doc;
+}
+
+soa_doc_t soa_doc_new_from_json(const char* json){
+    return soa_doc_new_from_json_flags(json, SOA_JSON_NONE);
+}
+
+soa_doc_t soa_doc_new_from_json_flags(const char* json, soa_json_parse_flags_t flags){
+    soa_error_t error;
+    soa_doc_t doc = soa_doc_new_from_json_err(json, flags, &error);
+    soa_error_set(error);
+    return doc;
+}
+
+// Work left once the containers are built
+static void _doc_finish(soa_doc_t* doc, soa_json_parse_flags_t flags){
+    soa_compact_t layout = 0;
+    if(flags & SOA_JSON_COLUMNS){
+        layout |= SOA_COMPACT_COLUMNS;
+    }
+    if(flags & (SOA_JSON_PACK_NUMBERS | SOA_JSON_PACK_F32)){
+        layout |= SOA_COMPACT_PACKED | (flags & SOA_JSON_PACK_F32 ? SOA_COMPACT_F32 : 0);
+    }
+    if(layout && doc->root_type){
+        soa_doc_compact(doc, SOA_COMPACT_GROUPED | layout);
+    }
+    if(flags & SOA_JSON_INDEX_KEYS){
+        soa_doc_build_index(doc);
+    }
+}
+
+soa_doc_t soa_doc_new_from_json_err(const char* json, soa_json_parse_flags_t flags, soa_error_t* error){
+    return soa_doc_new_from_json_n(json, strlen(json), flags, error);
+}
+
+soa_doc_t soa_doc_new_from_json_n(const char* json, size_t len, soa_json_parse_flags_t flags, soa_error_t* error){
+    return soa_doc_new_from_json_alloc(json, len, flags, NULL, error);
+}
+
+soa_doc_t soa_doc_new_from_json_alloc(const char* json, size_t len, soa_json_parse_flags_t flags, const soa_allocator_t* alloc, soa_error_t* error){
+    soa_error_t e = {0};
+    soa_doc_t doc = flags & SOA_JSON_SINGLE_PASS ? 
+        _doc_new_single_pass(json, len, flags, alloc, &e) : 
+        _doc_new_two_pass(json, len, flags, alloc, &e);
+    _doc_finish(&doc, flags);
+    if(error){
+        *error = e;
+    }
+    return doc;
+}
+
+soa_doc_t soa_doc_new_from_json_file(const char* path, soa_json_parse_flags_t flags, soa_error_t* error){
+    _soa_map_t map = _soa_map_file(path, 0);
+    if(!map.data){
+        if(error){
+            *error = (soa_error_t){"File could not be read!", 51, 0};
+        }
+        return soa_doc_new();
+    }
+    soa_doc_t doc = soa_doc_new_from_json_n(map.data, map.size, flags & ~SOA_JSON_INSITU, error);
+    _soa_unmap_file(&map);
+    return doc;
+}
+
+// Parser contexts
+
+struct soa_json_ctx {
+    _json_index_t x;
+    _json_info_t i;
+    _json_tape_t tp;
+};
+
+soa_json_ctx_t* soa_json_ctx_new(const soa_allocator_t* alloc){
+    soa_json_ctx_t* ctx = _soa_alloc(alloc, sizeof(soa_json_ctx_t));
+    ctx->x = (_json_index_t){.alloc = alloc};
+    ctx->i = _info_new(SOA_JSON_PREALLOC, alloc);
+    ctx->tp = _tape_new(SOA_JSON_PREALLOC, alloc);
+    return ctx;
+}
+
+void soa_json_ctx_free(soa_json_ctx_t* ctx){
+    if(!ctx) return;
+    const soa_allocator_t* alloc = ctx->x.alloc;
+    _index_free(&ctx->x);
+    _info_free(&ctx->i);
+    _tape_free(&ctx->tp);
+    _soa_free(alloc, ctx, sizeof(soa_json_ctx_t));
+}
+
+int soa_json_ctx_parse(soa_json_ctx_t* ctx, soa_doc_t* doc, const char* json, size_t len, soa_json_parse_flags_t flags, soa_error_t* error){
+    ctx->x.flags = flags;
+    ctx->x.error = (soa_error_t){0};
+    ctx->x.more = 0;
+    int ok = flags & SOA_JSON_SINGLE_PASS ? 
+        _parse_single_pass(&ctx->x, &ctx->tp, doc, json, len) : 
+        _parse_two_pass(&ctx->x, &ctx->i, doc, json, len);
+    if(!ok){
+        doc->size = 0;
+        doc->root = 0;
+        doc->root_type = SOA_ROOT_NULL;
+    }
+    else{
+        _doc_finish(doc, flags);
+    }
+    if(error){
+        *error = ctx->x.error;
+    }
+    // scalar roots leave an empty doc without an error
+    return !ctx->x.error.code;
+}
+
+// Push parser
+//
+// Input is indexed 64 bytes at a time as it arrives, with the string and
+// scalar state carried over, and the single pass builder runs as far as
+// the tokens go. Bytes before the oldest token in use are dropped, so the
+// buffer holds about one token plus a block.
+
+struct soa_json_parser {
+    _json_index_t x;
+    _json_tape_t tp;
+    soa_doc_t doc;
+    char* buf;
+    size_t cap;
+    size_t base; // offset of buf in the whole input
+};
+
+static void _parser_reset(soa_json_parser_t* p){
+    p->x.len = 0;
+    p->x.count = 0;
+    p->x.t = 0;
+    p->x.error = (soa_error_t){0};
+    p->x.indexed = 0;
+    p->x.prev_escaped = 0;
+    p->x.prev_in_string = 0;
+    p->x.prev_scalar = 0;
+    p->x.more = 1;
+    p->tp.size = 0;
+    p->tp.depth = 0;
+    p->tp.root = (soa_obj_entry_t){0};
+    p->tp.state = _JSON_BUILD_VALUE;
+    p->doc = soa_doc_new();
+    p->base = 0;
+}
+
+soa_json_parser_t* soa_json_parser_new(soa_json_parse_flags_t flags){
+    soa_json_parser_t* p = calloc(1, sizeof(soa_json_parser_t));
+    p->x.flags = flags & ~SOA_JSON_INSITU;
+    p->tp = _tape_new(SOA_JSON_PREALLOC, NULL);
+    _parser_reset(p);
+    return p;
+}
+
+void soa_json_parser_free(soa_json_parser_t* p){
+    if(!p){
+        return;
+    }
+    soa_doc_free(&p->doc);
+    _index_free(&p->x);
+    _tape_free(&p->tp);
+    free(p->buf);
+    free(p);
+}
+
+static int _parser_build(soa_json_parser_t* p){
+    if(!_build(&p->x, &p->tp, &p->doc)){
+        p->x.error.offset += p->base;
+        return 0;
+    }
+    return 1;
+}
+
+// Moving what is left costs no more than the bytes dropped
+static void _parser_compact(soa_json_parser_t* p){
+    _json_index_t* x = &p->x;
+    size_t drop = x->t < x->count ? x->pos[x->t] : x->indexed;
+    size_t keep = x->len - drop;
+    if(!drop || keep > drop){
+        return;
+    }
+    memmove(p->buf, p->buf + drop, keep);
+    for(size_t t = x->t; t < x->count; t++){
+        x->pos[t - x->t] = x->pos[t] - (uint32_t)drop;
+    }
+    x->count -= x->t;
+    x->t = 0;
+    x->len = keep;
+    x->indexed -= drop;
+    p->base += drop;
+}
+
+int soa_json_parser_feed(soa_json_parser_t* p, const char* data, size_t len){
+    _json_index_t* x = &p->x;
+    if(x->error.code){
+        return 0;
+    }
+    // anything after the root is ignored, like soa_doc_new_from_json does
+    if(p->tp.state == _JSON_BUILD_DONE || !len){
+        return 1;
+    }
+
+    _parser_compact(p);
+    if(x->len + len >= UINT32_MAX){
+        return _json_error(x, "Document too large!", 41, p->base + x->len);
+    }
+    if(x->len + len > p->cap){
+        size_t cap = (x->len + len) * 2;
+        char* buf = realloc(p->buf, cap);
+        if(!buf){
+            return _json_error(x, "Out of memory!", 42, p->base + x->len);
+        }
+        p->buf = buf;
+        p->cap = cap;
+    }
+    memcpy(p->buf + x->len, data, len);
+    x->len += len;
+    x->json = p->buf;
+
+    // a block short of 64 bytes waits for more input or finish
+    _index_blocks(x, x->len - (x->len - x->indexed) % 64);
+    return _parser_build(p);
+}
+
+soa_doc_t soa_json_parser_finish(soa_json_parser_t* p, soa_error_t* error){
+    _json_index_t* x = &p->x;
+    if(!x->error.code && p->tp.state != _JSON_BUILD_DONE){
+        x->json = p->buf;
+        _index_blocks(x, x->len);
+        _index_end(x);
+        _parser_build(p);
+    }
+
+    soa_doc_t doc = p->doc;
+    if(x->error.code || !doc.root_type){
+        soa_doc_free(&doc);
+    }
+    else{
+        doc.root = *(size_t*)&p->tp.root;
+        _doc_finish(&doc, x->flags);
+    }
+    if(error){
+        *error = x->error;
+    }
+    _parser_reset(p);
+    return doc;
+}
+
+// On demand reading
+//
+// Cursors never index the text. Skipping a value looks only at quotes,
+// backslashes and brackets, brackets of both kinds count as one depth
+// since nothing skipped is checked.
+
+// Position past the closing quote of a string whose bytes start at pos,
+// SIZE_MAX when the input ends first
+#ifdef SOA_JSON_X86
+SOA_TARGET("sse2")
+#endif
+static size_t _skip_str(const char* json, size_t len, size_t pos){
+    while(pos < len){
+#ifdef SOA_JSON_X86
+        if(len - pos >= 16){
+            __m128i v = _mm_loadu_si128((const __m128i*)(json + pos));
+            unsigned mask = (unsigned)_mm_movemask_epi8(_mm_or_si128(
+                _mm_cmpeq_epi8(v, _mm_set1_epi8('"')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))
+            ));
+            if(!mask){
+                pos += 16;
+                continue;
+            }
+            pos += _ctz64(mask);
+        }
+#endif
+        if(json[pos] == '"'){
+            return pos + 1;
+        }
+        pos += json[pos] == '\\' ? 2 : 1;
+    }
+    return SIZE_MAX;
+}
+
+typedef struct {
+    uint64_t quote;
+    uint64_t bs;
+    uint64_t open;
+    uint64_t close;
+} _json_nest_t;
+
+// Brackets of both kinds, '[' | 0x20 == '{' and ']' | 0x20 == '}'
+#ifdef SOA_JSON_X86
+SOA_TARGET("sse2")
+static void _classify_nest(const uint8_t* in, _json_nest_t* b){
+    *b = (_json_nest_t){0};
+    for (int i = 0; i < 4; i++) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(in + i * 16));
+        __m128i l = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        b->quote |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('"'))) << (i * 16);
+        b->bs    |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))) << (i * 16);
+        b->open  |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(l, _mm_set1_epi8('{'))) << (i * 16);
+        b->close |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(l, _mm_set1_epi8('}'))) << (i * 16);
+    }
+}
+#else
+static void _classify_nest(const uint8_t* in, _json_nest_t* b){
+    *b = (_json_nest_t){0};
+    for (int i = 0; i < 64; i++) {
+        uint64_t bit = 1ull << i;
+        switch(in[i] | 0x20){
+            case '{':
+                b->open |= bit;
+                break;
+            case '}':
+                b->close |= bit;
+                break;
+        }
+        b->quote |= in[i] == '"' ? bit : 0;
+        b->bs |= in[i] == '\\' ? bit : 0;
+    }
+}
+#endif
+
+// Position past the object or array opening at pos, SIZE_MAX when the
+// input ends inside it. Strings are masked out with the same carries the
+// structural index uses, a block whose closing brackets cannot bring the
+// depth to zero is passed over with two popcounts.
+static size_t _skip_nested(const char* json, size_t len, size_t pos){
+    uint64_t prev_escaped = 0;
+    uint64_t prev_in_string = 0;
+    size_t depth = 0;
+    for (size_t base = pos; base < len; base += 64) {
+        const uint8_t* in = (const uint8_t*)json + base;
+        uint8_t tail[64];
+        if(len - base < 64){
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, in, len - base);
+            in = tail;
+        }
+
+        _json_nest_t b;
+        _classify_nest(in, &b);
+        uint64_t quote = b.quote & ~_escaped(b.bs, &prev_escaped);
+        uint64_t in_string = _prefix_xor(quote) ^ prev_in_string;
+        prev_in_string = (uint64_t)((int64_t)in_string >> 63);
+        uint64_t open = b.open & ~in_string;
+        uint64_t close = b.close & ~in_string;
+
+        if((size_t)_popcount64(close) < depth){
+            depth += _popcount64(open) - _popcount64(close);
+            continue;
+        }
+        for (uint64_t brackets = open | close; brackets; brackets &= brackets - 1) {
+            int i = _ctz64(brackets);
+            if(open >> i & 1){
+                depth++;
+            }
+            else if(!--depth){
+                return base + i + 1;
+            }
+        }
+    }
+    return SIZE_MAX;
+}
+
+// End of the scalar at pos, the next whitespace or structural character
+inline static size_t _scalar_stop(const char* json, size_t len, size_t pos){
+    while(pos < len && !_is_ws_char(json[pos]) && json[pos] != ',' && json[pos] != ']' && json[pos] != '}'){
+        pos++;
+    }
+    return pos;
+}
+
+// Position past the value at pos, SIZE_MAX when the input ends inside it
+static size_t _skip_val(const char* json, size_t len, size_t pos){
+    if(json[pos] == '"'){
+        return _skip_str(json, len, pos + 1);
+    }
+    if(json[pos] != '[' && json[pos] != '{'){
+        return _scalar_stop(json, len, pos);
+    }
+    return _skip_nested(json, len, pos);
+}
+
+inline static size_t _skip_ws(const char* json, size_t len, size_t pos){
+    while(pos < len && _is_ws_char(json[pos])){
+        pos++;
+    }
+    return pos;
+}
+
+inline static int _cursor_error(soa_json_cursor_t* cur, const char* msg, int code, size_t offset){
+    cur->error = (soa_error_t){msg, code, offset};
+    return 0;
+}
+
+soa_json_cursor_t soa_json_cursor_new(const char* json, size_t len){
+    size_t start = _skip_ws(json, len, 0);
+    soa_json_cursor_t cur = {json, len, start, start, 0, {0}};
+    if(start == len){
+        _cursor_error(&cur, "Value expected", 32, start);
+    }
+    return cur;
+}
+
+// Reads the number at the cursor, type gets its soa_type_bit_t
+static int _cursor_num(soa_json_cursor_t* cur, soa_valu_t* value, uint8_t* type){
+    _json_index_t x = {.json = cur->json, .len = cur->len};
+    const char* ptr = cur->json + cur->start;
+    const char* end = cur->json + _scalar_stop(cur->json, cur->len, cur->start);
+    if(!(*ptr == '-' || _is_digit(*ptr))){
+        return _cursor_error(cur, "Value is not a number", 3, cur->start);
+    }
+    const char* stop = _parse_num(&x, ptr, end, value, type);
+    if(!stop){
+        cur->error = x.error;
+        return 0;
+    }
+    if(stop != end){
+        return _cursor_error(cur, "Value expected", 32, stop - cur->json);
+    }
+    return 1;
+}
+
+int soa_json_cursor_type(soa_json_cursor_t* cur, soa_type_t* type){
+    if(cur->error.code){
+        return 0;
+    }
+    switch(cur->json[cur->start]){
+        case '{':
+            *type = SOA_TYPE_OBJ;
+            return 1;
+        case '[':
+            *type = SOA_TYPE_ARR;
+            return 1;
+        case '"':
+            *type = SOA_TYPE_STR;
+            return 1;
+        case 't': case 'f': case 'n':{
+            soa_bool_t b;
+            *type = SOA_TYPE_BOOL;
+            return soa_json_cursor_bool(cur, &b);
+        }
+        default:{
+            soa_valu_t value;
+            return _cursor_num(cur, &value, type);
+        }
+    }
+}
+
+// Member after the one handed out last, key is SIZE_MAX for arrays
+static int _cursor_next(soa_json_cursor_t* cur, soa_json_cursor_t* value, size_t* key, size_t* key_len){
+    const char* json = cur->json;
+    size_t len = cur->len;
+    if(cur->error.code){
+        return 0;
+    }
+    char open = json[cur->start];
+    if(open != '{' && open != '['){
+        return _cursor_error(cur, "Value is not an object or array", 3, cur->start);
+    }
+    char close = open == '{' ? '}' : ']';
+    size_t pos = cur->pos;
+    if(pos == SIZE_MAX){
+        return 0;
+    }
+    if(pos == cur->start){
+        pos = _skip_ws(json, len, pos + 1);
+        if(pos < len && json[pos] == close){
+            cur->pos = SIZE_MAX;
+            return 0;
+        }
+    }
+    else{
+        pos = _skip_val(json, len, cur->member);
+        if(pos == SIZE_MAX){
+            return open == '{' ? _cursor_error(cur, "Object not terminated properly!", 11, cur->start) :
+                _cursor_error(cur, "Array not terminated properly!", 01, cur->start);
+        }
+        pos = _skip_ws(json, len, pos);
+        if(pos < len && json[pos] == close){
+            cur->pos = SIZE_MAX;
+            return 0;
+        }
+        if(pos == len || json[pos] != ','){
+            return open == '{' ? _cursor_error(cur, "Object not terminated properly!", 11, pos) :
+                _cursor_error(cur, "Array not terminated properly!", 01, pos);
+        }
+        pos = _skip_ws(json, len, pos + 1);
+    }
+
+    *key = SIZE_MAX;
+    if(open == '{'){
+        if(pos == len || json[pos] != '"'){
+            return _cursor_error(cur, "Invalid key: pair!!", 12, pos);
+        }
+        size_t end = _skip_str(json, len, pos + 1);
+        if(end == SIZE_MAX){
+            return _cursor_error(cur, "String not terminated properly!", 21, pos);
+        }
+        *key = pos + 1;
+        *key_len = end - pos - 2;
+        pos = _skip_ws(json, len, end);
+        if(pos == len || json[pos] != ':'){
+            return _cursor_error(cur, "Invalid key: pair!!", 12, pos);
+        }
+        pos = _skip_ws(json, len, pos + 1);
+    }
+    if(pos == len || json[pos] == ',' || json[pos] == ']' || json[pos] == '}'){
+        return _cursor_error(cur, "Value expected", 32, pos);
+    }
+    cur->pos = pos;
+    cur->member = pos;
+    *value = (soa_json_cursor_t){json, len, pos, pos, 0, {0}};
+    return 1;
+}
+
+int soa_json_cursor_next(soa_json_cursor_t* cur, soa_json_cursor_t* value, const char** key, size_t* key_len){
+    size_t k, n = 0;
+    if(!_cursor_next(cur, value, &k, &n)){
+        return 0;
+    }
+    if(key){
+        *key = k == SIZE_MAX ? NULL : cur->json + k;
+    }
+    if(key_len){
+        *key_len = n;
+    }
+    return 1;
+}
+
+// Compares a key as written with an unescaped one
+static int _cursor_key_eq(const char* raw, size_t raw_len, const char* key, size_t len){
+    if(!memchr(raw, '\\', raw_len)){
+        return raw_len == len && memcmp(raw, key, len) == 0;
+    }
+    // escapes only shorten a key
+    if(len > raw_len){
+        return 0;
+    }
+    char stack[256];
+    char* buf = raw_len < sizeof(stack) ? stack : malloc(raw_len + 1);
+    size_t marks;
+    int eq = _unescape(buf, raw, raw_len, &marks) == len && memcmp(buf, key, len) == 0;
+    if(buf != stack){
+        free(buf);
+    }
+    return eq;
+}
+
+int soa_json_cursor_find(soa_json_cursor_t* cur, const char* key, size_t len, soa_json_cursor_t* value){
+    if(cur->error.code){
+        return 0;
+    }
+    if(cur->json[cur->start] != '{'){
+        return _cursor_error(cur, "Value is not an object", 3, cur->start);
+    }
+    size_t from = cur->member;
+    size_t k, n;
+    for(int wrapped = 0; wrapped < 2; wrapped++){
+        while(_cursor_next(cur, value, &k, &n)){
+            if(wrapped && cur->member > from){
+                break;
+            }
+            if(_cursor_key_eq(cur->json + k, n, key, len)){
+                return 1;
+            }
         }
-        ptr = _skip_ws(ptr);
-        i->ae++;
-        size++;
-        if(*ptr == ','){
-            ptr = _skip_ws(++ptr);
+        if(cur->error.code || !from){
+            return 0;
         }
+        cur->pos = cur->start;
+        cur->member = 0;
     }
-    i->asizes[index] = size;
-    return ++ptr;
+    return 0;
 }
 
-static const char* _read_arr(const char* ptr, _json_info_t* i, _json_read_info_t* r){
-    ptr = _skip_ws(++ptr);
+int soa_json_cursor_bool(soa_json_cursor_t* cur, soa_bool_t* out){
+    if(cur->error.code){
+        return 0;
+    }
+    const char* ptr = cur->json + cur->start;
+    const char* end = cur->json + _scalar_stop(cur->json, cur->len, cur->start);
+    if(end - ptr == 4 && _is_literal(ptr, end, "true", 4)){
+        *out = SOA_BOOL_TRUE;
+    }
+    else if(end - ptr == 5 && _is_literal(ptr, end, "false", 5)){
+        *out = SOA_BOOL_FALSE;
+    }
+    else if(end - ptr == 4 && _is_literal(ptr, end, "null", 4)){
+        *out = SOA_BOOL_NULL;
+    }
+    else{
+        return _cursor_error(cur, "Value is not a boolean", 3, cur->start);
+    }
+    return 1;
+}
 
-    *(size_t*)r->ptr = r->a_offset;
+int soa_json_cursor_int(soa_json_cursor_t* cur, int64_t* out){
+    soa_valu_t v;
+    uint8_t type;
+    if(cur->error.code || !_cursor_num(cur, &v, &type)){
+        return 0;
+    }
+    if(type == SOA_TYPE_FLOAT || (type == SOA_TYPE_UINT && v.u > INT64_MAX)){
+        return _cursor_error(cur, "Value is not a signed integer", 3, cur->start);
+    }
+    *out = v.i;
+    return 1;
+}
 
-    r->ptr = r->data + r->a_offset;
-    memcpy(r->ptr, i->asizes + r->a, sizeof(size_t));
-    r->ptr += sizeof(size_t); 
-    r->a_offset += i->asizes[r->a] * sizeof(soa_arr_entry_t) + sizeof(size_t);
-    r->a++;
+int soa_json_cursor_uint(soa_json_cursor_t* cur, uint64_t* out){
+    soa_valu_t v;
+    uint8_t type;
+    if(cur->error.code || !_cursor_num(cur, &v, &type)){
+        return 0;
+    }
+    if(type == SOA_TYPE_FLOAT || (type == SOA_TYPE_INT && v.i < 0)){
+        return _cursor_error(cur, "Value is not an unsigned integer", 3, cur->start);
+    }
+    *out = v.u;
+    return 1;
+}
 
-    while(*ptr != ']'){
-        uint8_t* old = r->ptr;
-        ptr = _read_val(ptr, i, r);
-        r->ptr = old;
-        ptr = _skip_ws(ptr);
-        if(*ptr == ','){
-            ptr = _skip_ws(++ptr);
-        }
-        r->ptr += sizeof(soa_arr_entry_t);
+int soa_json_cursor_float(soa_json_cursor_t* cur, double* out){
+    soa_valu_t v;
+    uint8_t type;
+    if(cur->error.code || !_cursor_num(cur, &v, &type)){
+        return 0;
     }
-    return ++ptr;
+    *out = type == SOA_TYPE_FLOAT ? v.f : type == SOA_TYPE_INT ? (double)v.i : (double)v.u;
+    return 1;
 }
 
-static const char* _parse_val(const char* ptr, _json_info_t* i){
-    const char* val = ptr;
-    
-    if(!val){
+const char* soa_json_cursor_str_raw(soa_json_cursor_t* cur, size_t* len){
+    if(cur->error.code){
+        return NULL;
+    }
+    if(cur->json[cur->start] != '"'){
+        _cursor_error(cur, "Value is not a string", 3, cur->start);
+        return NULL;
+    }
+    size_t end = _skip_str(cur->json, cur->len, cur->start + 1);
+    if(end == SIZE_MAX){
+        _cursor_error(cur, "String not terminated properly!", 21, cur->start);
         return NULL;
     }
+    *len = end - cur->start - 2;
+    return cur->json + cur->start + 1;
+}
 
-    switch(*val){
-    case '[':
-        val = _parse_arr(val, i);
-        break;
-    case '{':
-        val = _parse_obj(val, i);
-        break;
-    case '"':
-        val = _parse_str(val, i);
-        break;    
-    default:
-        val = _parse_num_or_bool(val, i);
-        if(!val){
-            soa_error_push("Value expected", 32);
-            return NULL;
-        }
+size_t soa_json_cursor_str(soa_json_cursor_t* cur, char* buf, size_t size){
+    size_t len;
+    const char* raw = soa_json_cursor_str_raw(cur, &len);
+    if(!raw || size <= len){
+        return SIZE_MAX;
     }
-    
-    return val;
-} 
+    size_t marks;
+    return _unescape(buf, raw, len, &marks);
+}
 
-static const char* _read_val(const char* ptr, _json_info_t* i, _json_read_info_t* r){
-    const char* val = ptr;
-    uint8_t* type = (r->ptr + sizeof(soa_valu_t));
+const char* soa_json_cursor_raw(soa_json_cursor_t* cur, size_t* len){
+    if(cur->error.code){
+        return NULL;
+    }
+    size_t end = _skip_val(cur->json, cur->len, cur->start);
+    if(end == SIZE_MAX){
+        _cursor_error(cur, "Value not terminated properly!", 32, cur->start);
+        return NULL;
+    }
+    *len = end - cur->start;
+    return cur->json + cur->start;
+}
 
-    switch(*val){
-    case '[':
-        val = _read_arr(val, i, r);
-        *type = SOA_TYPE_ARR; 
-        break;
-    case '{':
-        val = _read_obj(val, i, r);
-        *type = SOA_TYPE_OBJ; 
-        break;
-    case '"':{
-        uint8_t sso;
-        val = _read_str(val, i, r, &sso);
-        *type = sso ? SOA_TYPE_SSO : SOA_TYPE_STR; 
-        break;    
+// Number formatting
+//
+// Integers are written two digits at a time from a table. Doubles are
+// converted with Schubfach to the shortest digits that read back to the
+// same double, closest to the exact value, then laid out like %.17g but
+// always with a '.' or an exponent so they stay floats when read again.
+
+// Longest output is -2.2250738585072014e-308
+#define SOA_JSON_NUM_MAX 24
+
+static const char _digit_pairs[] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static char* _write_u64(uint64_t v, char* out){
+    char buf[20];
+    char* p = buf + sizeof(buf);
+    while(v >= 100){
+        uint64_t q = v / 100;
+        p -= 2;
+        memcpy(p, _digit_pairs + (v - q * 100) * 2, 2);
+        v = q;
     }
-    default:
-        val = _read_num_or_bool(val, i, r, type);
+    if(v >= 10){
+        p -= 2;
+        memcpy(p, _digit_pairs + v * 2, 2);
     }
-    
-    return val;
+    else{
+        *--p = (char)('0' + v);
+    }
+    size_t n = buf + sizeof(buf) - p;
+    memcpy(out, p, n);
+    return out + n;
 }
 
-soa_doc_t soa_doc_new_from_json(const char* json){
-    soa_error_pop();
-    _json_info_t i = _info_new(SOA_JSON_PREALLOC);
+static char* _write_i64(int64_t v, char* out){
+    if(v < 0){
+        *out++ = '-';
+        return _write_u64(0 - (uint64_t)v, out);
+    }
+    return _write_u64((uint64_t)v, out);
+}
 
-    _parse_val(json, &i);
+inline static int32_t _flog10_pow2(int32_t e){
+    return (int32_t)((e * 661971961083ll) >> 41);
+}
 
-    // printf("ao: %lu ae: %lu\noo: %lu oe: %lu\nstr: %lu str_size: %lu\n", 
-    //     i.ao, i.ae,
-    //     i.oo, i.oe,
-    //     i.str, i.str_size
-    // );
+inline static int32_t _flog10_three_quarters_pow2(int32_t e){
+    return (int32_t)((e * 661971961083ll - 274743187321ll) >> 41);
+}
 
-    if(soa_error_get().code || !i.root_type) return (soa_doc_t){0};
+inline static int32_t _flog2_pow10(int32_t e){
+    return (int32_t)((e * 913124641741ll) >> 38);
+}
 
-    // for (size_t j = 0; j < i.ao; j++) {
-    //     printf("arr %lu: %lu\n", j, i.asizes[j]);
-    // }
-    // for (size_t j = 0; j < i.oo; j++) {
-    //     printf("obj %lu: %lu\n", j, i.osizes[j]);
-    // }
+// Upper 64 bits of g * cp / 2^128, rounded to odd
+inline static uint64_t _round_to_odd(uint64_t g_hi, uint64_t g_lo, uint64_t cp){
+    uint64_t x_hi, y_hi;
+    _mul128(g_lo, cp, &x_hi);
+    uint64_t y_lo = _mul128(g_hi, cp, &y_hi);
+    uint64_t z = y_lo + x_hi;
+    uint64_t z_hi = y_hi + (z < x_hi);
+    return z_hi | (z > 1);
+}
 
-    soa_doc_t doc = soa_doc_new();
-    
-    doc.size =
-    (i.ao + i.oo) * sizeof(size_t) + 
-    i.ae * sizeof(soa_arr_entry_t) +
-    i.oe * sizeof(soa_obj_entry_t) +
-    i.str_size;
-    doc.cap = doc.size;
-    doc.data = malloc(doc.size);
-    doc.root_type = i.root_type;
-    
-    if(i.root_type == SOA_ROOT_ARR){
-        _read_arr(json, &i, &(_json_read_info_t){
-            0, 0, 
-            0, i.ao * sizeof(size_t) + i.ae * sizeof(soa_arr_entry_t), 
-            (i.ao + i.oo) * sizeof(size_t) + i.ae * sizeof(soa_arr_entry_t) + i.oe * sizeof(soa_obj_entry_t), 
-            doc.data, doc.data
-        });
-        doc.root = 0;
+typedef struct {
+    uint64_t digits;
+    int32_t exp;
+} _json_decimal_t;
+
+// Finite and non zero
+static _json_decimal_t _to_decimal(uint64_t bits){
+    uint64_t fraction = bits & 0x000FFFFFFFFFFFFFull;
+    int32_t exponent = (int32_t)((bits >> 52) & 0x7FF);
+    uint64_t c = exponent ? fraction | (1ull << 52) : fraction;
+    int32_t q = exponent ? exponent - 1075 : -1074;
+    int32_t dk = 0;
+
+    // integers below 2^53 are exact already
+    if(q <= 0 && q > -53 && (c & ((1ull << -q) - 1)) == 0){
+        return (_json_decimal_t){c >> -q, 0};
     }
-    else{
-        _read_obj(json, &i, &(_json_read_info_t){
-            0, 0, 
-            0, i.ao * sizeof(size_t) + i.ae * sizeof(soa_arr_entry_t), 
-            (i.ao + i.oo) * sizeof(size_t) + i.ae * sizeof(soa_arr_entry_t) + i.oe * sizeof(soa_obj_entry_t), 
-            doc.data, doc.data
-        });
-        doc.root = i.ao * sizeof(size_t) + i.ae * sizeof(soa_arr_entry_t);
+    // tiny subnormals need one more digit of headroom
+    if(c < 3){
+        c *= 10;
+        dk = -1;
     }
 
+    int even = (c & 1) == 0;
+    int closer = fraction == 0 && exponent > 1;
+    uint64_t cb = c << 2;
+    uint64_t cbr = cb + 2;
+    uint64_t cbl = closer ? cb - 1 : cb - 2;
+    int32_t k = closer ? _flog10_three_quarters_pow2(q) : _flog10_pow2(q);
+    int32_t h = q + _flog2_pow10(-k) + 1;
+
+    // table is truncated, only powers from 10^0 to 10^55 fit 128 bits exactly
+    const uint64_t* p = _pow10_128[-k - SOA_POW10_MIN];
+    uint64_t g_lo = p[0];
+    uint64_t g_hi = p[1];
+    if(-k < 0 || -k > 55){
+        g_lo++;
+        g_hi += g_lo == 0;
+    }
 
+    uint64_t vbl = _round_to_odd(g_hi, g_lo, cbl << h);
+    uint64_t vb = _round_to_odd(g_hi, g_lo, cb << h);
+    uint64_t vbr = _round_to_odd(g_hi, g_lo, cbr << h);
+    uint64_t lower = vbl + !even;
+    uint64_t upper = vbr - !even;
+
+    uint64_t s = vb >> 2;
+    if(s >= 10){
+        uint64_t sp10 = s / 10 * 10;
+        int up_in = lower <= sp10 << 2;
+        int wp_in = (sp10 + 10) << 2 <= upper;
+        if(up_in != wp_in){
+            return (_json_decimal_t){up_in ? sp10 : sp10 + 10, k + dk};
+        }
+    }
+    int u_in = lower <= s << 2;
+    int w_in = (s + 1) << 2 <= upper;
+    if(u_in != w_in){
+        return (_json_decimal_t){u_in ? s : s + 1, k + dk};
+    }
+    uint64_t mid = (s << 2) + 2;
+    int round_up = vb > mid || (vb == mid && (s & 1));
+    return (_json_decimal_t){round_up ? s + 1 : s, k + dk};
+}
 
-    _info_free(&i);
+// Lays out positive digits like %.17g with a '.' or an exponent
+static char* _write_decimal(_json_decimal_t dec, char* out){
+    while(dec.digits % 10 == 0){
+        dec.digits /= 10;
+        dec.exp++;
+    }
+    char buf[20];
+    int32_t n = (int32_t)(_write_u64(dec.digits, buf) - buf);
+    int32_t x = dec.exp + n - 1;
+
+    if(x < -4 || x >= 17){
+        *out++ = buf[0];
+        if(n > 1){
+            *out++ = '.';
+            memcpy(out, buf + 1, n - 1);
+            out += n - 1;
+        }
+        *out++ = 'e';
+        if(x < 0){
+            *out++ = '-';
+            x = -x;
+        }
+        return _write_u64((uint64_t)x, out);
+    }
+    if(x >= n - 1){
+        memcpy(out, buf, n);
+        out += n;
+        memset(out, '0', x - n + 1);
+        out += x - n + 1;
+        memcpy(out, ".0", 2);
+        return out + 2;
+    }
+    if(x >= 0){
+        memcpy(out, buf, x + 1);
+        out += x + 1;
+        *out++ = '.';
+        memcpy(out, buf + x + 1, n - x - 1);
+        return out + n - x - 1;
+    }
+    *out++ = '0';
+    *out++ = '.';
+    memset(out, '0', -x - 1);
+    out += -x - 1;
+    memcpy(out, buf, n);
+    return out + n;
+}
 
-    return doc;
+// Needs SOA_JSON_NUM_MAX bytes, NULL for infinity and NaN
+static char* _write_double(double d, char* out){
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    if(((bits >> 52) & 0x7FF) == 0x7FF){
+        return NULL;
+    }
+    if(bits >> 63){
+        *out++ = '-';
+    }
+    if(!(bits << 1)){
+        memcpy(out, "0.0", 3);
+        return out + 3;
+    }
+
+    return _write_decimal(_to_decimal(bits), out);
 }
 
+// Singles take the shortest of the double's digits, rounded, that still
+// reads back to the same float
+static char* _write_f32(float f, char* out){
+    double d = f;
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    if(((bits >> 52) & 0x7FF) == 0x7FF){
+        return NULL;
+    }
+    if(bits >> 63){
+        *out++ = '-';
+    }
+    if(!(bits << 1)){
+        memcpy(out, "0.0", 3);
+        return out + 3;
+    }
+
+    _json_decimal_t dec = _to_decimal(bits);
+    while(dec.digits % 10 == 0){
+        dec.digits /= 10;
+        dec.exp++;
+    }
+    int32_t n = 1;
+    for (uint64_t v = dec.digits; v >= 10; v /= 10) {
+        n++;
+    }
+    uint64_t scale = 1;
+    for (int32_t i = 0; i < n; i++) {
+        scale *= 10;
+    }
+    // 9 digits always tell singles apart
+    for (int32_t p = 1; p < n && p <= 9; p++) {
+        scale /= 10;
+        uint64_t r = (dec.digits + scale / 2) / scale;
+        int32_t exp = dec.exp + n - p;
+        // read back the way the parser would
+        char num[SOA_JSON_NUM_MAX];
+        char* end = _write_u64(r, num);
+        *end++ = 'e';
+        end = _write_i64(exp, end);
+        if((float)_num_to_double(r, exp, 0, num, end) == (f < 0 ? -f : f)){
+            dec = (_json_decimal_t){r, exp};
+            break;
+        }
+    }
+    return _write_decimal(dec, out);
+}
 
 
-void _print_val(soa_val_t* val, _soa_str_t* str, soa_json_parse_flags_t flags, size_t tabs);
+static void _print_val(soa_val_t* val, _soa_str_t* str, soa_json_parse_flags_t flags, size_t tabs);
 
-void _print_tabs(_soa_str_t* str, soa_json_parse_flags_t flags, size_t tabs){
+static void _print_tabs(_soa_str_t* str, soa_json_parse_flags_t flags, size_t tabs){
     if(flags & SOA_JSON_PRETTIFY){
-        _soa_str_add(str, "\n");
-        if(tabs == 0) return;
+        _soa_str_lit(str, "\n");
         for (size_t t = 0; t < tabs; t++) {
-            _soa_str_add(str, SOA_JSON_PRETTIFY_TAB);
+            _soa_str_lit(str, SOA_JSON_PRETTIFY_TAB);
+        }
+    }
+}
+
+// Bytes that print as they are, 16 at a time where there is SSE2
+#ifdef SOA_JSON_X86
+SOA_TARGET("sse2")
+#endif
+static size_t _escape_scan(const char* s, size_t n, int utf){
+    size_t i = 0;
+#ifdef SOA_JSON_X86
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i bs = _mm_set1_epi8('\\');
+    const __m128i slash = _mm_set1_epi8('/');
+    const __m128i ctrl = _mm_set1_epi8(0x1F);
+    const __m128i space = _mm_set1_epi8(0x20);
+    const __m128i del = _mm_set1_epi8(0x7F);
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+        __m128i m = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, bs)),
+            _mm_cmpeq_epi8(v, slash)
+        );
+        // signed, bytes from 0x80 are below 0x20 too
+        m = _mm_or_si128(m, utf ?
+            _mm_or_si128(_mm_cmplt_epi8(v, space), _mm_cmpeq_epi8(v, del)) :
+            _mm_cmpeq_epi8(_mm_min_epu8(v, ctrl), v)
+        );
+        int mask = _mm_movemask_epi8(m);
+        if(mask){
+            return i + _ctz64((uint64_t)mask);
         }
     }
+#endif
+    while(i < n && !(_escape_class((uint8_t)s[i]) & (utf ? 3 : 1))){
+        i++;
+    }
+    return i;
 }
 
-void _print_str(const char* s, _soa_str_t* str, soa_json_parse_flags_t flags){
-    _soa_str_add(str, "\"");
-    while(*s){
+static void _print_str(const char* s, size_t n, _soa_str_t* str, soa_json_parse_flags_t flags){
+    const char* end = s + n;
+    int utf = !!(flags & SOA_JSON_ENCODE_UTF);
+    _soa_str_lit(str, "\"");
+    while(s < end){
+        size_t clean = _escape_scan(s, end - s, utf);
+        if(clean){
+            _soa_str_add(str, s, clean);
+            s += clean;
+            if(s == end){
+                break;
+            }
+        }
+
         uint32_t cp;
         size_t len = _utf8_decode((uint8_t*)s, &cp);
         
         switch(cp){
             case '\"':
-                _soa_str_add(str, "\\\"");
+                _soa_str_lit(str, "\\\"");
                 break;
             case '\\':
-                _soa_str_add(str, "\\\\");
+                _soa_str_lit(str, "\\\\");
                 break;
             case '/':
-                _soa_str_add(str, "\\/");
+                _soa_str_lit(str, "\\/");
                 break;
             case '\b':
-                _soa_str_add(str, "\\b");
+                _soa_str_lit(str, "\\b");
                 break;
             case '\f':
-                _soa_str_add(str, "\\f");
+                _soa_str_lit(str, "\\f");
                 break;
             case '\n':
-                _soa_str_add(str, "\\n");
+                _soa_str_lit(str, "\\n");
                 break;
             case '\r':
-                _soa_str_add(str, "\\r");
+                _soa_str_lit(str, "\\r");
                 break;
             case '\t':
-                _soa_str_add(str, "\\t");
+                _soa_str_lit(str, "\\t");
                 break;
             default:
                 /* ASCII */
-                if (cp >= 0x20 && cp <= 0x7E || (flags & SOA_JSON_ENCODE_UTF) == 0) {
-                    char* added = _soa_str_add_size(str, 1);
-                    size_t i = 0;
-                    for (; i < len; i++) {
-                        added[i] = *(s + i);
-                    }
-                    added[i] = 0;
+                if ((cp >= 0x20 && cp <= 0x7E) || (cp > 0x7E && (flags & SOA_JSON_ENCODE_UTF) == 0)) {
+                    _soa_str_add(str, s, len);
                 }
                 /* BMP Unicode */
                 else if (cp <= 0xFFFF) {
-                    _soa_str_add(str, "\\u");
-                    char d[5];
-                    _write_u4(cp, d);
-                    d[4] = 0;
-                    _soa_str_add(str, d);
+                    char* d = _soa_str_add_size(str, 6);
+                    d[0] = '\\';
+                    d[1] = 'u';
+                    _write_u4(cp, d + 2);
                 }
                 /* Surrogate pair */
                 else {
@@ -833,66 +3176,86 @@ void _print_str(const char* s, _soa_str_t* str, soa_json_parse_flags_t flags){
                     uint16_t hi = 0xD800 | (cp >> 10);
                     uint16_t lo = 0xDC00 | (cp & 0x3FF);
                     
-                    char d[5];
-                    d[4] = 0;
-
-                    _soa_str_add(str, "\\u");
-                    _write_u4(hi, d);
-                    _soa_str_add(str, d);
-                    
-                    _soa_str_add(str, "\\u");
-                    _write_u4(lo, d);
-                    _soa_str_add(str, d);
+                    char* d = _soa_str_add_size(str, 12);
+                    d[0] = '\\';
+                    d[1] = 'u';
+                    _write_u4(hi, d + 2);
+                    d[6] = '\\';
+                    d[7] = 'u';
+                    _write_u4(lo, d + 8);
                 }
                 break;
         }
         s += len;
     }
-    _soa_str_add(str, "\"");
+    _soa_str_lit(str, "\"");
 }
 
-void _print_obj(soa_obj_t* obj, _soa_str_t* str, soa_json_parse_flags_t flags, size_t tabs){
-    _soa_str_add(str, "{");
+static void _print_obj(soa_obj_t* obj, _soa_str_t* str, soa_json_parse_flags_t flags, size_t tabs){
+    _soa_str_lit(str, "{");
     size_t size = soa_obj_length(obj);
     for (size_t i = 0; i < size; i++) {
         _print_tabs(str, flags, tabs + 1);
         soa_val_t val = soa_obj_val_at_index(obj, i);
-        _print_str(soa_obj_key_at(obj, i), str, flags);
-        _soa_str_add(str, flags & SOA_JSON_PRETTIFY ? ": " : ":");
+        size_t len;
+        const char* key = soa_obj_key_at_n(obj, i, &len);
+        _print_str(key, len, str, flags);
+        if(flags & SOA_JSON_PRETTIFY){
+            _soa_str_lit(str, ": ");
+        }
+        else{
+            _soa_str_lit(str, ":");
+        }
         _print_val(&val, str, flags, tabs + 1);
         if(i != size - 1 ){
-            _soa_str_add(str, ",");
+            _soa_str_lit(str, ",");
         }
     }
 
     _print_tabs(str, flags, tabs);
-    _soa_str_add(str, "}");
+    _soa_str_lit(str, "}");
 }
 
-void _print_arr(soa_arr_t* arr, _soa_str_t* str, soa_json_parse_flags_t flags, size_t tabs){
-    _soa_str_add(str, "[");
+static void _print_arr(soa_arr_t* arr, _soa_str_t* str, soa_json_parse_flags_t flags, size_t tabs){
+    _soa_str_lit(str, "[");
     size_t size = soa_arr_length(arr);
     for (size_t i = 0; i < size; i++) {
         _print_tabs(str, flags, tabs + 1);
         soa_val_t val = soa_arr_val_at(arr, i);
         _print_val(&val, str, flags, tabs + 1);
         if(i != size - 1 ){
-            _soa_str_add(str, ",");
+            _soa_str_lit(str, ",");
         }
     }
 
     _print_tabs(str, flags, tabs);
-    _soa_str_add(str, "]");
+    _soa_str_lit(str, "]");
 }
 
-void _print_val(soa_val_t* val, _soa_str_t* str, soa_json_parse_flags_t flags, size_t tabs){
+static void _print_val(soa_val_t* val, _soa_str_t* str, soa_json_parse_flags_t flags, size_t tabs){
     soa_type_t type = soa_val_type(val);
 
     switch (type){
         case SOA_TYPE_STR:
         case SOA_TYPE_SSO:
-            _print_str(soa_val_str(val), str, flags);
+        case SOA_TYPE_REF:{
+            size_t len;
+            const char* s = soa_val_str_n(val, &len);
+            size_t marks = 0;
+            if(type == SOA_TYPE_STR){
+                memcpy(&marks, s - sizeof(size_t), sizeof(size_t));
+            }
+            // the parser saw nothing to escape
+            if(marks & _SOA_STR_CLEAN && (marks & _SOA_STR_ASCII || !(flags & SOA_JSON_ENCODE_UTF))){
+                _soa_str_lit(str, "\"");
+                _soa_str_add(str, s, len);
+                _soa_str_lit(str, "\"");
+            }
+            else{
+                _print_str(s, len, str, flags);
+            }
             break;
+        }
         case SOA_TYPE_ARR:{
             soa_arr_t arr = soa_val_arr(val);
             _print_arr(&arr, str, flags, tabs);
@@ -906,50 +3269,345 @@ void _print_val(soa_val_t* val, _soa_str_t* str, soa_json_parse_flags_t flags, s
         case SOA_TYPE_BOOL:{
             switch (soa_val_bool(val)){
                 case SOA_BOOL_FALSE:
-                    _soa_str_add(str, "false");
+                    _soa_str_lit(str, "false");
                     break;
                 case SOA_BOOL_TRUE:
-                    _soa_str_add(str, "true");
+                    _soa_str_lit(str, "true");
                     break;
                 default:
-                    _soa_str_add(str, "null");
+                    _soa_str_lit(str, "null");
                     break;
             }
             break;
         }
         case SOA_TYPE_INT:{
-            size_t size = snprintf(NULL, 0, SOA_LD_FORMAT, soa_val_int(val));
-            snprintf(_soa_str_add_size(str, size + 1), size + 1, SOA_LD_FORMAT, soa_val_int(val));
+            char* num = _soa_str_add_size(str, SOA_JSON_NUM_MAX);
+            _soa_str_unadd(str, num + SOA_JSON_NUM_MAX - _write_i64(soa_val_int(val), num));
             break;
         }
         case SOA_TYPE_UINT:{
-            size_t size = snprintf(NULL, 0, SOA_LU_FORMAT, soa_val_uint(val));
-            snprintf(_soa_str_add_size(str, size + 1), size + 1, SOA_LU_FORMAT, soa_val_uint(val));
+            char* num = _soa_str_add_size(str, SOA_JSON_NUM_MAX);
+            _soa_str_unadd(str, num + SOA_JSON_NUM_MAX - _write_u64(soa_val_uint(val), num));
             break;
         }
-        case SOA_TYPE_FLOAT:{
-            size_t size = snprintf(NULL, 0, "%g", soa_val_float(val));
-            snprintf(_soa_str_add_size(str, size + 1), size + 1, "%g", soa_val_float(val));
+        case SOA_TYPE_FLOAT:
+        case SOA_TYPE_F32:{
+            char* num = _soa_str_add_size(str, SOA_JSON_NUM_MAX);
+            char* end = soa_val_type(val) == SOA_TYPE_F32 ?
+                _write_f32((float)soa_val_float(val), num) :
+                _write_double(soa_val_float(val), num);
+            if(end){
+                _soa_str_unadd(str, num + SOA_JSON_NUM_MAX - end);
+            }
+            else{
+                // JSON has no infinity or NaN
+                _soa_str_unadd(str, SOA_JSON_NUM_MAX);
+                _soa_str_lit(str, "null");
+            }
             break;
         }
         default:
-            _soa_str_add(str, "null");
+            _soa_str_lit(str, "null");
             break;
     }
 }
 
-
-char* soa_json_new_from_doc(soa_doc_t* doc, soa_json_parse_flags_t flags){
-    _soa_str_t str = _soa_str_new(64);
-
+static void _print_doc(soa_doc_t* doc, _soa_str_t* str, soa_json_parse_flags_t flags){
     if(doc->root_type == SOA_ROOT_ARR){
         soa_arr_t root = soa_doc_root_arr(doc);
-        _print_arr(&root, &str, flags, 0);
+        _print_arr(&root, str, flags, 0);
     }
     else {
         soa_obj_t root = soa_doc_root_obj(doc);
-        _print_obj(&root, &str, flags, 0);
+        _print_obj(&root, str, flags, 0);
+    }
+}
+
+// Cheap upper bound of the output size for the common case, only strings
+// that need escaping can make the real output longer
+static size_t _estimate_val(soa_val_t* val, soa_json_parse_flags_t flags, size_t tabs);
+
+static size_t _estimate_tabs(soa_json_parse_flags_t flags, size_t tabs){
+    if(flags & SOA_JSON_PRETTIFY){
+        return 1 + tabs * (sizeof(SOA_JSON_PRETTIFY_TAB) - 1);
+    }
+    return 0;
+}
+
+static size_t _estimate_obj(soa_obj_t* obj, soa_json_parse_flags_t flags, size_t tabs){
+    size_t size = soa_obj_length(obj);
+    size_t total = 2 + _estimate_tabs(flags, tabs);
+    for (size_t i = 0; i < size; i++) {
+        soa_val_t val = soa_obj_val_at_index(obj, i);
+        size_t len;
+        soa_obj_key_at_n(obj, i, &len);
+        total += _estimate_tabs(flags, tabs + 1) + len + 5;
+        total += _estimate_val(&val, flags, tabs + 1);
+    }
+    return total;
+}
+
+static size_t _estimate_arr(soa_arr_t* arr, soa_json_parse_flags_t flags, size_t tabs){
+    size_t size = soa_arr_length(arr);
+    size_t total = 2 + _estimate_tabs(flags, tabs);
+    for (size_t i = 0; i < size; i++) {
+        soa_val_t val = soa_arr_val_at(arr, i);
+        total += _estimate_tabs(flags, tabs + 1) + 1;
+        total += _estimate_val(&val, flags, tabs + 1);
+    }
+    return total;
+}
+
+static size_t _estimate_val(soa_val_t* val, soa_json_parse_flags_t flags, size_t tabs){
+    switch (soa_val_type(val)){
+        case SOA_TYPE_STR:
+        case SOA_TYPE_SSO:
+        case SOA_TYPE_REF:{
+            size_t len;
+            soa_val_str_n(val, &len);
+            return len + 2;
+        }
+        case SOA_TYPE_ARR:{
+            soa_arr_t arr = soa_val_arr(val);
+            return _estimate_arr(&arr, flags, tabs);
+        }
+        case SOA_TYPE_OBJ:{
+            soa_obj_t obj = soa_val_obj(val);
+            return _estimate_obj(&obj, flags, tabs);
+        }
+        case SOA_TYPE_BOOL:
+            return 5;
+        default:
+            return SOA_JSON_NUM_MAX;
+    }
+}
+
+static size_t _count_write(void* user, const char* data, size_t size){
+    (void)user;
+    (void)data;
+    return size;
+}
+
+// Truncates silently so the total keeps counting, like snprintf
+static size_t _buf_write(void* user, const char* data, size_t size){
+    _soa_str_t* buf = user;
+    size_t left = buf->cap - buf->size;
+    size_t copy = size > left ? left : size;
+    memcpy(buf->str + buf->size, data, copy);
+    buf->size += copy;
+    return size;
+}
+
+static size_t _file_write(void* user, const char* data, size_t size){
+    return fwrite(data, 1, size, (FILE*)user);
+}
+
+static size_t _fd_write(void* user, const char* data, size_t size){
+    int fd = (int)(intptr_t)user;
+    size_t total = 0;
+    while(total < size){
+#ifdef _WIN32
+        int written = _write(fd, data + total, (unsigned)(size - total));
+#else
+        ssize_t written = write(fd, data + total, size - total);
+#endif
+        if(written <= 0) break;
+        total += written;
     }
+    return total;
+}
+
+char* soa_json_new_from_doc(soa_doc_t* doc, soa_json_parse_flags_t flags){
+    size_t size;
+    return soa_json_new_from_doc_alloc(doc, flags, NULL, &size);
+}
+
+char* soa_json_new_from_doc_alloc(soa_doc_t* doc, soa_json_parse_flags_t flags, const soa_allocator_t* alloc, size_t* size){
+    soa_arr_t arr = soa_doc_root_arr(doc);
+    soa_obj_t obj = soa_doc_root_obj(doc);
+    size_t estimate = doc->root_type == SOA_ROOT_ARR ? 
+        _estimate_arr(&arr, flags, 0) :
+        _estimate_obj(&obj, flags, 0);
+    _soa_str_t str = _soa_str_new(estimate + 1, alloc);
 
+    _print_doc(doc, &str, flags);
+
+    *_soa_str_add_size(&str, 1) = 0;
+    *size = str.cap;
     return str.str;
-}
\ No newline at end of file
+}
+
+size_t soa_json_write_from_doc(soa_doc_t* doc, soa_json_parse_flags_t flags, soa_json_sink_t sink){
+    char buffer[SOA_JSON_SINK_BUFFER];
+    _soa_str_t str = _soa_str_new_sink(sink, buffer, sizeof(buffer));
+
+    _print_doc(doc, &str, flags);
+
+    _soa_str_flush(&str);
+    return str.total;
+}
+
+size_t soa_json_len_from_doc(soa_doc_t* doc, soa_json_parse_flags_t flags){
+    return soa_json_write_from_doc(doc, flags, (soa_json_sink_t){_count_write, NULL});
+}
+
+size_t soa_json_buf_from_doc(soa_doc_t* doc, soa_json_parse_flags_t flags, char* buf, size_t size){
+    _soa_str_t out = {.str = buf, .cap = size ? size - 1 : 0};
+    char buffer[SOA_JSON_SINK_BUFFER];
+    _soa_str_t str = _soa_str_new_sink((soa_json_sink_t){_buf_write, &out}, buffer, sizeof(buffer));
+
+    _print_doc(doc, &str, flags);
+
+    _soa_str_flush(&str);
+    if(size){
+        buf[out.size] = 0;
+    }
+    return str.total;
+}
+
+size_t soa_json_file_from_doc(soa_doc_t* doc, soa_json_parse_flags_t flags, FILE* file){
+    return soa_json_write_from_doc(doc, flags, (soa_json_sink_t){_file_write, file});
+}
+
+size_t soa_json_fd_from_doc(soa_doc_t* doc, soa_json_parse_flags_t flags, int fd){
+    return soa_json_write_from_doc(doc, flags, (soa_json_sink_t){_fd_write, (void*)(intptr_t)fd});
+}
+
+
+// Streaming writer
+
+struct soa_json_writer {
+    _soa_str_t str;
+    soa_json_parse_flags_t flags;
+    size_t depth;
+    uint8_t first;     // nothing written yet in the open container
+    uint8_t after_key; // value goes right after its key
+    char buffer[SOA_JSON_SINK_BUFFER];
+};
+
+soa_json_writer_t* soa_json_writer_new(soa_json_sink_t sink, soa_json_parse_flags_t flags){
+    soa_json_writer_t* w = calloc(1, sizeof(soa_json_writer_t));
+    w->str = _soa_str_new_sink(sink, w->buffer, sizeof(w->buffer));
+    w->flags = flags;
+    return w;
+}
+
+void soa_json_writer_free(soa_json_writer_t* w){
+    free(w);
+}
+
+// Comma and line break before a member, the way _print_obj and _print_arr
+// place them
+static void _writer_member(soa_json_writer_t* w){
+    if(w->after_key){
+        w->after_key = 0;
+        return;
+    }
+    if(!w->depth){
+        return;
+    }
+    if(!w->first){
+        _soa_str_lit(&w->str, ",");
+    }
+    w->first = 0;
+    _print_tabs(&w->str, w->flags, w->depth);
+}
+
+static void _writer_end(soa_json_writer_t* w){
+    if(w->depth){
+        w->depth--;
+    }
+    w->first = 0;
+    _print_tabs(&w->str, w->flags, w->depth);
+}
+
+void soa_json_writer_obj_begin(soa_json_writer_t* w){
+    _writer_member(w);
+    _soa_str_lit(&w->str, "{");
+    w->depth++;
+    w->first = 1;
+}
+
+void soa_json_writer_obj_end(soa_json_writer_t* w){
+    _writer_end(w);
+    _soa_str_lit(&w->str, "}");
+}
+
+void soa_json_writer_arr_begin(soa_json_writer_t* w){
+    _writer_member(w);
+    _soa_str_lit(&w->str, "[");
+    w->depth++;
+    w->first = 1;
+}
+
+void soa_json_writer_arr_end(soa_json_writer_t* w){
+    _writer_end(w);
+    _soa_str_lit(&w->str, "]");
+}
+
+void soa_json_writer_key(soa_json_writer_t* w, const char* key, size_t len){
+    _writer_member(w);
+    _print_str(key, len, &w->str, w->flags);
+    if(w->flags & SOA_JSON_PRETTIFY){
+        _soa_str_lit(&w->str, ": ");
+    }
+    else{
+        _soa_str_lit(&w->str, ":");
+    }
+    w->after_key = 1;
+}
+
+void soa_json_writer_str(soa_json_writer_t* w, const char* s, size_t len){
+    _writer_member(w);
+    _print_str(s, len, &w->str, w->flags);
+}
+
+void soa_json_writer_int(soa_json_writer_t* w, int64_t val){
+    _writer_member(w);
+    char* num = _soa_str_add_size(&w->str, SOA_JSON_NUM_MAX);
+    _soa_str_unadd(&w->str, num + SOA_JSON_NUM_MAX - _write_i64(val, num));
+}
+
+void soa_json_writer_uint(soa_json_writer_t* w, uint64_t val){
+    _writer_member(w);
+    char* num = _soa_str_add_size(&w->str, SOA_JSON_NUM_MAX);
+    _soa_str_unadd(&w->str, num + SOA_JSON_NUM_MAX - _write_u64(val, num));
+}
+
+void soa_json_writer_float(soa_json_writer_t* w, double val){
+    _writer_member(w);
+    char* num = _soa_str_add_size(&w->str, SOA_JSON_NUM_MAX);
+    char* end = _write_double(val, num);
+    if(end){
+        _soa_str_unadd(&w->str, num + SOA_JSON_NUM_MAX - end);
+    }
+    else{
+        _soa_str_unadd(&w->str, SOA_JSON_NUM_MAX);
+        _soa_str_lit(&w->str, "null");
+    }
+}
+
+void soa_json_writer_bool(soa_json_writer_t* w, soa_bool_t val){
+    _writer_member(w);
+    switch (val){
+        case SOA_BOOL_FALSE:
+            _soa_str_lit(&w->str, "false");
+            break;
+        case SOA_BOOL_TRUE:
+            _soa_str_lit(&w->str, "true");
+            break;
+        default:
+            _soa_str_lit(&w->str, "null");
+            break;
+    }
+}
+
+size_t soa_json_writer_finish(soa_json_writer_t* w){
+    _soa_str_flush(&w->str);
+    size_t total = w->str.total;
+    w->str = _soa_str_new_sink(w->str.sink, w->buffer, sizeof(w->buffer));
+    w->depth = 0;
+    w->first = 0;
+    w->after_key = 0;
+    return total;
+}
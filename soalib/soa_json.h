@@ -31,27 +31,198 @@ extern "C" {
 
 #include "soa.h"
 
+#include <stdio.h>
+
 #ifndef SOA_JSON_PREALLOC
 #define SOA_JSON_PREALLOC 8
 #endif
 
+#ifndef SOA_JSON_SINK_BUFFER
+#define SOA_JSON_SINK_BUFFER 4096
+#endif
+
 #ifndef SOA_JSON_PRETTIFY_TAB
 #define SOA_JSON_PRETTIFY_TAB "    "
 #endif
 
-soa_doc_t soa_doc_new_from_json(const char* json);
-
 typedef enum {
     SOA_JSON_NONE = 0,
     SOA_JSON_PRETTIFY = 1,
-    SOA_JSON_ENCODE_UTF = 2
+    SOA_JSON_ENCODE_UTF = 2,
+    SOA_JSON_SINGLE_PASS = 4,
+    SOA_JSON_INDEX_KEYS = 8,
+    SOA_JSON_STRICT_INT = 16,
+    SOA_JSON_INSITU = 32,
+    SOA_JSON_COLUMNS = 64,
+    SOA_JSON_PACK_NUMBERS = 128,
+    SOA_JSON_PACK_F32 = 256,
+    SOA_JSON_VALIDATE_UTF = 512
 } soa_json_flag_bit_t;
 
 typedef uint32_t soa_json_parse_flags_t;
 
+// Token positions and soa_ref_t offsets are 32 bit, every parse below fails
+// on documents of 4 GB and over with code 41 "Document too large!".
+soa_doc_t soa_doc_new_from_json(const char* json);
+
+// SOA_JSON_SINGLE_PASS skips the sizing pass, containers are laid out
+// when they close and the doc grows as needed
+// SOA_JSON_INDEX_KEYS builds key indexes of large objects while parsing
+// SOA_JSON_STRICT_INT fails on integers outside 64 bits instead of reading floats
+// SOA_JSON_INSITU leaves strings without escapes in json, which has to
+// outlive the doc, see SOA_TYPE_REF
+// SOA_JSON_COLUMNS lays containers out in columns once parsed, see
+// SOA_COMPACT_COLUMNS, at the cost of one more copy of the doc
+// SOA_JSON_PACK_NUMBERS packs arrays of numbers of one type the same way,
+// see SOA_COMPACT_PACKED, SOA_JSON_PACK_F32 also rounds floats to singles
+// SOA_JSON_VALIDATE_UTF fails on strings that are not well formed UTF-8
+soa_doc_t soa_doc_new_from_json_flags(const char* json, soa_json_parse_flags_t flags);
+
+// Reports through error instead of the thread's last error, error.code is 0
+// on success. Safe to call from any number of threads at once.
+soa_doc_t soa_doc_new_from_json_err(const char* json, soa_json_parse_flags_t flags, soa_error_t* error);
+
+// Parses exactly len bytes, json needs no null terminator and nothing past
+// it is read
+soa_doc_t soa_doc_new_from_json_n(const char* json, size_t len, soa_json_parse_flags_t flags, soa_error_t* error);
+
+// Doc and scratch memory come from alloc, which has to outlive the doc
+soa_doc_t soa_doc_new_from_json_alloc(const char* json, size_t len, soa_json_parse_flags_t flags, const soa_allocator_t* alloc, soa_error_t* error);
+
+// Maps the file instead of reading it into a buffer, SOA_JSON_INSITU is
+// ignored as the mapping is gone once this returns
+soa_doc_t soa_doc_new_from_json_file(const char* path, soa_json_parse_flags_t flags, soa_error_t* error);
+
+// Parser context, keeps its scratch memory between documents. Parsing
+// into the same doc again reuses its buffer when the document fits, so
+// steady state parses allocate nothing. Scratch comes from alloc, the
+// doc's buffer from doc->alloc. One thread at a time.
+typedef struct soa_json_ctx soa_json_ctx_t;
+
+soa_json_ctx_t* soa_json_ctx_new(const soa_allocator_t* alloc);
+void soa_json_ctx_free(soa_json_ctx_t* ctx);
+
+// Replaces what doc held, doc is left empty on failure. Returns 0 on error.
+int soa_json_ctx_parse(soa_json_ctx_t* ctx, soa_doc_t* doc, const char* json, size_t len, soa_json_parse_flags_t flags, soa_error_t* error);
+
+// Push parser, takes the document in pieces of any size and builds the
+// doc while input arrives. SOA_JSON_INSITU is ignored, input is copied.
+typedef struct soa_json_parser soa_json_parser_t;
+
+soa_json_parser_t* soa_json_parser_new(soa_json_parse_flags_t flags);
+void soa_json_parser_free(soa_json_parser_t* parser);
+
+// Returns 0 once the input is known to be invalid, finish tells why.
+// Input not yet built into the doc is kept, the 4 GB limit is on that and
+// not on the whole stream. Running out of memory for it fails
+// with code 42 "Out of memory!".
+int soa_json_parser_feed(soa_json_parser_t* parser, const char* data, size_t len);
+
+// Ends the document, the parser can take the next one afterwards.
+// Error offsets count from the first byte fed.
+soa_doc_t soa_json_parser_finish(soa_json_parser_t* parser, soa_error_t* error);
+
+// On demand reading
+//
+// A cursor reads one value in place in the json text, nothing is built or
+// allocated. Members of objects and arrays are visited front to back and
+// the ones passed over are skipped by matching brackets and quotes, so
+// only values that are read get checked. The text has to outlive the
+// cursors. Cursors are plain values, a member keeps working after its
+// container has moved on.
+typedef struct {
+    const char* json;
+    size_t len;
+    size_t start;  // first byte of the value
+    size_t pos;    // of containers, where reading goes on
+    size_t member; // of containers, start of the member handed out last, 0 before the first
+    soa_error_t error;
+} soa_json_cursor_t;
+
+// Cursor at the value json holds
+soa_json_cursor_t soa_json_cursor_new(const char* json, size_t len);
+
+// SOA_TYPE_OBJ, SOA_TYPE_ARR, SOA_TYPE_STR, SOA_TYPE_BOOL for true, false
+// and null, or the number type the parser would pick. 0 when invalid.
+int soa_json_cursor_type(soa_json_cursor_t* cur, soa_type_t* type);
+
+// Moves to the next member of an object or array, returns 0 at the end
+// and on errors, which are left in cur->error. Object members get their
+// key as written, escapes included, key and key_len can be NULL.
+int soa_json_cursor_next(soa_json_cursor_t* cur, soa_json_cursor_t* value, const char** key, size_t* key_len);
+
+// Moves on to the member with key, wrapping around once when it lies
+// behind. Keys asked for in document order read the object once.
+int soa_json_cursor_find(soa_json_cursor_t* cur, const char* key, size_t len, soa_json_cursor_t* value);
+
+// Return 0 when the value is not of the type or out of its range
+int soa_json_cursor_bool (soa_json_cursor_t* cur, soa_bool_t* out); // null reads as SOA_BOOL_NULL
+int soa_json_cursor_int  (soa_json_cursor_t* cur, int64_t* out);
+int soa_json_cursor_uint (soa_json_cursor_t* cur, uint64_t* out);
+int soa_json_cursor_float(soa_json_cursor_t* cur, double* out);
+
+// Bytes between the quotes as written, escapes included
+const char* soa_json_cursor_str_raw(soa_json_cursor_t* cur, size_t* len);
+
+// Unescapes into buf, which needs the raw length and a terminator. Returns
+// the length, SIZE_MAX when it is not a string or buf is too small.
+size_t soa_json_cursor_str(soa_json_cursor_t* cur, char* buf, size_t size);
+
+// Text of the whole value, to pass it on unchanged
+const char* soa_json_cursor_raw(soa_json_cursor_t* cur, size_t* len);
+
+// Returns number of bytes accepted, anything less than size stops the output
+typedef size_t (*soa_json_write_fn)(void* user, const char* data, size_t size);
+
+typedef struct {
+    soa_json_write_fn write;
+    void* user;
+} soa_json_sink_t;
+
 // User is responsible for freeing memory
 char* soa_json_new_from_doc(soa_doc_t* doc, soa_json_parse_flags_t flags);
 
+// Freed with alloc and the size written to size
+char* soa_json_new_from_doc_alloc(soa_doc_t* doc, soa_json_parse_flags_t flags, const soa_allocator_t* alloc, size_t* size);
+
+// Exact length of the output, without null terminator
+size_t soa_json_len_from_doc(soa_doc_t* doc, soa_json_parse_flags_t flags);
+
+// Streams output in SOA_JSON_SINK_BUFFER chunks, returns bytes written
+size_t soa_json_write_from_doc(soa_doc_t* doc, soa_json_parse_flags_t flags, soa_json_sink_t sink);
+
+// Works like snprintf, returns full length even when buf is too small
+size_t soa_json_buf_from_doc(soa_doc_t* doc, soa_json_parse_flags_t flags, char* buf, size_t size);
+size_t soa_json_file_from_doc(soa_doc_t* doc, soa_json_parse_flags_t flags, FILE* file);
+size_t soa_json_fd_from_doc(soa_doc_t* doc, soa_json_parse_flags_t flags, int fd);
+
+// Streaming writer, prints values one by one without building a doc. The
+// output is the same as printing a doc holding them, with SOA_JSON_PRETTIFY
+// and SOA_JSON_ENCODE_UTF honored. Commas and line breaks are placed by the
+// writer, keeping begins, ends and keys paired is up to the caller.
+typedef struct soa_json_writer soa_json_writer_t;
+
+soa_json_writer_t* soa_json_writer_new(soa_json_sink_t sink, soa_json_parse_flags_t flags);
+void soa_json_writer_free(soa_json_writer_t* writer);
+
+void soa_json_writer_obj_begin(soa_json_writer_t* writer);
+void soa_json_writer_obj_end(soa_json_writer_t* writer);
+void soa_json_writer_arr_begin(soa_json_writer_t* writer);
+void soa_json_writer_arr_end(soa_json_writer_t* writer);
+
+// Key of the next object member
+void soa_json_writer_key(soa_json_writer_t* writer, const char* key, size_t len);
+
+void soa_json_writer_str(soa_json_writer_t* writer, const char* str, size_t len);
+void soa_json_writer_int(soa_json_writer_t* writer, int64_t val);
+void soa_json_writer_uint(soa_json_writer_t* writer, uint64_t val);
+void soa_json_writer_float(soa_json_writer_t* writer, double val); // infinity and NaN print as null
+void soa_json_writer_bool(soa_json_writer_t* writer, soa_bool_t val);
+
+// Flushes to the sink and returns bytes written, the writer can take the
+// next document afterwards
+size_t soa_json_writer_finish(soa_json_writer_t* writer);
+
 #ifdef __cplusplus
 } 
 #endif
@@ -24,19 +24,21 @@ SOFTWARE.
 
 #pragma once
 
+#include <algorithm>
+#include <iterator>
+
 #include "soa.hpp"
 #include "soa.h"
 #include "soa_json.h"
+#include "soa_ndjson.h"
 
 namespace soa::json {
 
 inline static auto parse(const str json)-> result<doc>{
-    auto doc = soa_doc_new_from_json(json.data());
-    soa_error_t e = soa_error_get();
+    soa_error_t e;
+    auto doc = soa_doc_new_from_json_n(json.data(), json.size(), SOA_JSON_NONE, &e);
     if(e.code){
-        auto result = err{e.msg, e.code};
-        soa_error_pop();
-        return result_error(result);
+        return result_error(err{e.msg, e.code, e.offset});
     }
     return doc;
 }
@@ -44,15 +46,451 @@ inline static auto parse(const str json)-> result<doc>{
 enum class parse_flag_bits : uint32_t {
     none = 0,
     prettify = 1,
-    encode_utf = 2
+    encode_utf = 2,
+    single_pass = 4,
+    index_keys = 8,
+    strict_int = 16,
+    insitu = 32,
+    columns = 64,
+    pack_numbers = 128,
+    pack_f32 = 256,
+    validate_utf = 512
 };
 using parse_flags = flags<parse_flag_bits,
-    (size_t)parse_flag_bits::prettify | (size_t)parse_flag_bits::encode_utf
+    (size_t)parse_flag_bits::prettify | (size_t)parse_flag_bits::encode_utf | 
+    (size_t)parse_flag_bits::single_pass | (size_t)parse_flag_bits::index_keys |
+    (size_t)parse_flag_bits::strict_int | (size_t)parse_flag_bits::insitu |
+    (size_t)parse_flag_bits::columns | (size_t)parse_flag_bits::pack_numbers |
+    (size_t)parse_flag_bits::pack_f32 | (size_t)parse_flag_bits::validate_utf
 >;
 
+// With parse_flag_bits::insitu strings are views into json, keep it alive
+inline static auto parse(const str json, parse_flags flags)-> result<doc>{
+    soa_error_t e;
+    auto doc = soa_doc_new_from_json_n(json.data(), json.size(), static_cast<soa_json_parse_flags_t>(flags), &e);
+    if(e.code){
+        return result_error(err{e.msg, e.code, e.offset});
+    }
+    return doc;
+}
+
+// Doc and scratch memory come from alloc, see pmr_allocator and soa_pool_allocator
+inline static auto parse(const str json, parse_flags flags, const soa_allocator_t* alloc)-> result<doc>{
+    soa_error_t e;
+    auto doc = soa_doc_new_from_json_alloc(json.data(), json.size(), static_cast<soa_json_parse_flags_t>(flags), alloc, &e);
+    if(e.code){
+        return result_error(err{e.msg, e.code, e.offset});
+    }
+    return doc;
+}
+
+// Maps the file, parse_flag_bits::insitu is ignored
+inline static auto parse_file(const string& path, parse_flags flags = {})-> result<doc>{
+    soa_error_t e;
+    auto doc = soa_doc_new_from_json_file(path.c_str(), static_cast<soa_json_parse_flags_t>(flags), &e);
+    if(e.code){
+        return result_error(err{e.msg, e.code, e.offset});
+    }
+    return doc;
+}
+
 inline static str_buffer stringify(doc& doc, parse_flags flags){
     return soa_json_new_from_doc(&doc.d, static_cast<soa_json_parse_flags_t>(flags));
 }
 
+// Overwrites out, its capacity is kept between calls
+inline static void stringify(doc& doc, string& out, parse_flags flags){
+    out.clear();
+    soa_json_write_from_doc(&doc.d, static_cast<soa_json_parse_flags_t>(flags), {
+        [](void* user, const char* data, size_t size) -> size_t {
+            static_cast<string*>(user)->append(data, size);
+            return size;
+        },
+        &out
+    });
+}
+
+// Push parser, takes the document in pieces as they arrive
+struct stream_parser {
+    soa_json_parser_t* p;
+
+    inline stream_parser(parse_flags flags = {}) :p(soa_json_parser_new(static_cast<soa_json_parse_flags_t>(flags))) {}
+    stream_parser(const stream_parser&) = delete;
+
+    inline ~stream_parser(){
+        soa_json_parser_free(p);
+    }
+
+    // false once the input is known to be invalid, finish returns the error
+    inline bool feed(const str data){
+        return soa_json_parser_feed(p, data.data(), data.size());
+    }
+
+    // Parser takes the next document afterwards
+    inline auto finish()-> result<doc>{
+        soa_error_t e;
+        soa_doc_t d = soa_json_parser_finish(p, &e);
+        if(e.code){
+            return result_error(err{e.msg, e.code, e.offset});
+        }
+        return d;
+    }
+};
+
+// Keeps its scratch between documents, parsing into the same doc again
+// reuses its memory, see soa_json_ctx_t
+struct parser {
+    soa_json_ctx_t* ctx;
+
+    inline parser(const soa_allocator_t* alloc = nullptr) :ctx(soa_json_ctx_new(alloc)) {}
+    parser(const parser&) = delete;
+
+    inline ~parser(){
+        soa_json_ctx_free(ctx);
+    }
+
+    // Replaces what out held, with parse_flag_bits::insitu strings are views into json
+    inline error parse(const str json, doc& out, parse_flags flags = {}){
+        soa_error_t e;
+        if(!soa_json_ctx_parse(ctx, &out.d, json.data(), json.size(), static_cast<soa_json_parse_flags_t>(flags), &e)){
+            return err{e.msg, e.code, e.offset};
+        }
+        return std::nullopt;
+    }
+
+    inline auto parse(const str json, parse_flags flags = {})-> result<doc>{
+        doc out;
+        if(auto e = parse(json, out, flags)){
+            return result_error(*e);
+        }
+        return out;
+    }
+};
+
+// Forward only cursor over json text, see soa_json_cursor_t. Nothing is
+// built, members passed over are skipped and only values read get
+// decoded. json has to outlive it and every member taken from it.
+struct ondemand {
+    soa_json_cursor_t c;
+
+    inline ondemand(const str json) :c(soa_json_cursor_new(json.data(), json.size())) {}
+    inline constexpr ondemand(soa_json_cursor_t c) :c(c) {}
+
+    inline error last_error() const {
+        if(c.error.code){
+            return err{c.error.msg, c.error.code, c.error.offset};
+        }
+        return std::nullopt;
+    }
+
+    inline auto type()-> result<soa::type>{
+        soa_type_t t;
+        if(!soa_json_cursor_type(&c, &t)){
+            return result_error(*last_error());
+        }
+        return static_cast<soa::type>(t);
+    }
+
+    // Next member, key stays empty for arrays. false at the end and on
+    // errors, see last_error()
+    inline bool next(ondemand& value, str* key = nullptr){
+        const char* k;
+        size_t len;
+        if(!soa_json_cursor_next(&c, &value.c, &k, &len)){
+            return false;
+        }
+        if(key){
+            *key = k ? str{k, len} : str{};
+        }
+        return true;
+    }
+
+    // Same with keys unescaped, buf holds the ones that had escapes
+    inline bool next(ondemand& value, str& key, string& buf){
+        if(!next(value, &key)){
+            return false;
+        }
+        if(key.find('\\') != str::npos){
+            // key is a view into json just past its opening quote
+            soa_json_cursor_t k = soa_json_cursor_new(key.data() - 1, key.size() + 2);
+            buf.resize(key.size());
+            buf.resize(soa_json_cursor_str(&k, buf.data(), key.size() + 1));
+            key = buf;
+        }
+        return true;
+    }
+
+    // Asking for keys in document order reads the object once
+    inline auto find(const str key)-> result<ondemand>{
+        soa_json_cursor_t v;
+        if(!soa_json_cursor_find(&c, key.data(), key.size(), &v)){
+            if(c.error.code) return result_error(*last_error());
+            return result_error({"key not found", 4});
+        }
+        return ondemand{v};
+    }
+
+    inline auto operator[](const str key)-> result<ondemand>{
+        return find(key);
+    }
+
+    // Text of the whole value, to pass it on unchanged
+    inline auto raw()-> result<str>{
+        size_t len;
+        const char* r = soa_json_cursor_raw(&c, &len);
+        if(!r) return result_error(*last_error());
+        return str{r, len};
+    }
+
+    // Reads into out, keeping what it already holds on errors. str only
+    // for strings without escapes, string unescapes. Types declared with
+    // the SOA_SERIALIZE_* macros, array_container and map_container are
+    // read member by member, see serializer_json.
+    template<typename T>
+    inline error read(T& out){
+        if constexpr (std::same_as<T, bool> || std::same_as<T, boolean>){
+            soa_bool_t b;
+            if(!soa_json_cursor_bool(&c, &b)) return last_error();
+            if constexpr (std::same_as<T, bool>) out = b == SOA_BOOL_TRUE;
+            else out = static_cast<boolean>(b);
+        }
+        else if constexpr (std::signed_integral<T>){
+            i64 v;
+            if(!soa_json_cursor_int(&c, &v)) return last_error();
+            out = static_cast<T>(v);
+        }
+        else if constexpr (std::unsigned_integral<T>){
+            u64 v;
+            if(!soa_json_cursor_uint(&c, &v)) return last_error();
+            out = static_cast<T>(v);
+        }
+        else if constexpr (std::floating_point<T>){
+            f64 v;
+            if(!soa_json_cursor_float(&c, &v)) return last_error();
+            out = static_cast<T>(v);
+        }
+        else if constexpr (std::same_as<T, str> || std::same_as<T, string>){
+            size_t len;
+            const char* raw = soa_json_cursor_str_raw(&c, &len);
+            if(!raw) return last_error();
+            if constexpr (std::same_as<T, str>){
+                if(std::memchr(raw, '\\', len)) return err{"string has escapes, read it as string", 3};
+                out = str{raw, len};
+            }
+            else{
+                out.resize(len);
+                out.resize(soa_json_cursor_str(&c, out.data(), len + 1));
+            }
+        }
+        else if constexpr (requires { T::template serializer<serializer_mode::read_json, T&>(out, *this); }){
+            return T::template serializer<serializer_mode::read_json, T&>(out, *this);
+        }
+        else if constexpr (array_container<T>){
+            ondemand member{c};
+            size_t n = 0;
+            while(next(member)){
+                if(n == out.size()) out.resize(n + 1);
+                if(auto e = member.read(out.at(n))) return e;
+                n++;
+            }
+            if(auto e = last_error()) return e;
+            out.resize(n);
+        }
+        else if constexpr (map_container<T>){
+            ondemand member{c};
+            str key;
+            string buf;
+            while(next(member, key, buf)){
+                typename T::mapped_type v{};
+                if(auto e = member.read(v)) return e;
+                out.insert(std::pair<string, typename T::mapped_type>{key, std::move(v)});
+            }
+            return last_error();
+        }
+        else{
+            static_assert(sizeof(T) == 0, "type can't be read from json");
+        }
+        return std::nullopt;
+    }
+
+    template<typename T>
+    inline auto as()-> result<T>{
+        T t{};
+        if(auto e = read(t)) return result_error(*e);
+        return t;
+    }
+};
+
+// Fills a type straight from json text, without building a doc. Unknown
+// keys are skipped and only the values taken are checked.
+template<typename T>
+inline static auto parse_into(const str json)-> result<T>{
+    return ondemand{json}.as<T>();
+}
+
+// Reuses what out already holds, strings and vectors keep their capacity
+template<typename T>
+inline static error parse_into(const str json, T& out){
+    return ondemand{json}.read(out);
+}
+
+// Prints values straight to a sink, see soa_json_writer_t. Keeps its
+// buffer between documents, finish ends one.
+struct writer {
+    soa_json_writer_t* w;
+
+    inline writer(soa_json_sink_t sink, parse_flags flags = {}) :w(soa_json_writer_new(sink, static_cast<soa_json_parse_flags_t>(flags))) {}
+    // Appends to out
+    inline writer(string& out, parse_flags flags = {}) :writer(soa_json_sink_t{
+        [](void* user, const char* data, size_t size) -> size_t {
+            static_cast<string*>(user)->append(data, size);
+            return size;
+        },
+        &out
+    }, flags) {}
+    writer(const writer&) = delete;
+
+    inline ~writer(){
+        soa_json_writer_free(w);
+    }
+
+    inline void begin(soa::type t){
+        if(t == soa::type::arr) soa_json_writer_arr_begin(w);
+        else soa_json_writer_obj_begin(w);
+    }
+
+    inline void end(soa::type t){
+        if(t == soa::type::arr) soa_json_writer_arr_end(w);
+        else soa_json_writer_obj_end(w);
+    }
+
+    inline void write_key(const str key){
+        soa_json_writer_key(w, key.data(), key.size());
+    }
+
+    inline void null(){
+        soa_json_writer_bool(w, SOA_BOOL_NULL);
+    }
+
+    // Same types ondemand::read takes, printed the way a doc they were
+    // written into would be
+    template<typename T>
+    inline void write(const T& value){
+        if constexpr (std::same_as<T, bool>){
+            soa_json_writer_bool(w, value ? SOA_BOOL_TRUE : SOA_BOOL_FALSE);
+        }
+        else if constexpr (std::same_as<T, boolean>){
+            soa_json_writer_bool(w, static_cast<soa_bool_t>(value));
+        }
+        else if constexpr (std::signed_integral<T>){
+            soa_json_writer_int(w, static_cast<i64>(value));
+        }
+        else if constexpr (std::unsigned_integral<T>){
+            soa_json_writer_uint(w, static_cast<u64>(value));
+        }
+        else if constexpr (std::floating_point<T>){
+            soa_json_writer_float(w, static_cast<f64>(value));
+        }
+        else if constexpr (std::same_as<T, str> || std::same_as<T, string>){
+            soa_json_writer_str(w, value.data(), value.size());
+        }
+        else if constexpr (requires { T::template serializer<serializer_mode::write_json, const T&>(value, *this); }){
+            T::template serializer<serializer_mode::write_json, const T&>(value, *this);
+        }
+        else if constexpr (array_container<T>){
+            soa_json_writer_arr_begin(w);
+            for (size_t i = 0; i < value.size(); i++) {
+                write(value.at(i));
+            }
+            soa_json_writer_arr_end(w);
+        }
+        else if constexpr (map_container<T>){
+            soa_json_writer_obj_begin(w);
+            for (auto it = value.begin(); it != value.end(); ++it) {
+                write_key(it->first);
+                write(it->second);
+            }
+            soa_json_writer_obj_end(w);
+        }
+        else{
+            static_assert(sizeof(T) == 0, "type can't be written as json");
+        }
+    }
+
+    // Returns bytes written
+    inline size_t finish(){
+        return soa_json_writer_finish(w);
+    }
+};
+
+// Prints a type straight to sink without building a doc, returns bytes written
+template<typename T>
+inline static size_t to_json(const T& value, soa_json_sink_t sink, parse_flags flags = {}){
+    writer w(sink, flags);
+    w.write(value);
+    return w.finish();
+}
+
+// Overwrites out, its capacity is kept between calls
+template<typename T>
+inline static void to_json(const T& value, string& out, parse_flags flags = {}){
+    out.clear();
+    writer w(out, flags);
+    w.write(value);
+    w.finish();
+}
+
+enum class lines_order {
+    ordered = SOA_NDJSON_ORDERED,
+    unordered = SOA_NDJSON_UNORDERED
+};
+
+struct line {
+    size_t index; // SIZE_MAX with lines_order::unordered
+    size_t offset;
+    result<doc> value;
+};
+
+// Parses one document per line on a thread pool, see soa_ndjson_parse.
+// fn takes line& and may return bool, false stops. Unordered calls come
+// from several threads at once. Returns number of lines delivered.
+template<typename F>
+requires std::invocable<F&, line&>
+inline static size_t parse_lines(const str data, F&& fn, parse_flags flags = {}, lines_order order = lines_order::ordered, size_t threads = 0){
+    soa_ndjson_opts_t opts = {
+        [](void* user, soa_ndjson_record_t* r) -> int {
+            F& f = *static_cast<std::remove_reference_t<F>*>(user);
+            line l = r->error.code ?
+                line{r->index, r->offset, result_error(err{r->error.msg, r->error.code, r->error.offset})} :
+                line{r->index, r->offset, result<doc>(std::in_place, r->doc)};
+            if constexpr (std::is_void_v<std::invoke_result_t<F&, line&>>){
+                f(l);
+                return 0;
+            }
+            else{
+                return !f(l);
+            }
+        },
+        (void*)&fn,
+        static_cast<soa_json_parse_flags_t>(flags),
+        static_cast<soa_ndjson_flags_t>(order),
+        threads
+    };
+    return soa_ndjson_parse(data.data(), data.size(), opts);
+}
+
+template<std::output_iterator<char> It>
+inline static It stringify_to(doc& doc, It out, parse_flags flags){
+    soa_json_write_from_doc(&doc.d, static_cast<soa_json_parse_flags_t>(flags), {
+        [](void* user, const char* data, size_t size) -> size_t {
+            It& it = *static_cast<It*>(user);
+            it = std::copy(data, data + size, it);
+            return size;
+        },
+        &out
+    });
+    return out;
+}
+
 }
 
@@ -0,0 +1,416 @@
+/*
+MIT License
+
+Copyright (c) 2026 Błażej Dombek <blazejdombek@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "soa_ndjson.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+// Records are lines, json strings cannot hold a raw newline so cutting at
+// '\n' never splits a valid record. The input is cut into chunks at line
+// ends and chunk c is queued on worker c % workers, so all workers move
+// through the input front to back together. A worker that runs out
+// steals the oldest chunk left in any queue, which is also the one
+// ordered delivery is waiting for.
+
+typedef struct {
+    soa_ndjson_record_t* records;
+    size_t size;
+    size_t cap;
+    atomic_int done;
+} _ndjson_chunk_t;
+
+typedef struct {
+    atomic_size_t next; // queue position, chunk is next * workers + worker
+    size_t end;
+} _ndjson_queue_t;
+
+typedef struct {
+    const char* data;
+    soa_ndjson_opts_t opts;
+
+    size_t* bounds; // chunk c is data[bounds[c]..bounds[c + 1]]
+    _ndjson_chunk_t* chunks;
+    size_t chunk_count;
+    _ndjson_queue_t* queues;
+    size_t workers;
+
+    // owned by whoever set delivering
+    atomic_int delivering;
+    size_t deliver;
+    size_t index;
+
+    atomic_size_t delivered;
+    atomic_int stop;
+    atomic_int oom;
+} _ndjson_job_t;
+
+// Threads sleep between parses, the one calling soa_ndjson_parse is
+// worker 0 and pool threads join as workers 1 and up while the job is
+// posted. Threads that wake after it was taken down sit it out, their
+// chunks are stolen like those of any slow worker.
+struct soa_ndjson_pool {
+    mtx_t run; // held for a whole parse
+    mtx_t lock;
+    cnd_t wake;
+    cnd_t idle;
+    _ndjson_job_t* job; // NULL while no parse takes workers
+    size_t generation;
+    size_t joined;
+    size_t busy;
+    int quit;
+    thrd_t* ids;
+    size_t threads;
+};
+
+static size_t _ndjson_cpu_count(){
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (size_t)n : 1;
+#endif
+}
+
+inline static int _ndjson_blank(const char* ptr, const char* end){
+    while(ptr < end && (*ptr == ' ' || *ptr == '\t' || *ptr == '\r')){
+        ptr++;
+    }
+    return ptr == end;
+}
+
+static size_t _ndjson_take(_ndjson_job_t* p, size_t worker){
+    _ndjson_queue_t* q = p->queues + worker;
+    if(atomic_load_explicit(&q->next, memory_order_relaxed) >= q->end){
+        return SIZE_MAX;
+    }
+    size_t k = atomic_fetch_add_explicit(&q->next, 1, memory_order_relaxed);
+    return k < q->end ? k * p->workers + worker : SIZE_MAX;
+}
+
+static size_t _ndjson_next(_ndjson_job_t* p, size_t worker){
+    size_t c = _ndjson_take(p, worker);
+    while(c == SIZE_MAX){
+        size_t victim = SIZE_MAX;
+        size_t oldest = SIZE_MAX;
+        for(size_t w = 0; w < p->workers; w++){
+            _ndjson_queue_t* q = p->queues + w;
+            size_t k = atomic_load_explicit(&q->next, memory_order_relaxed);
+            if(k < q->end && k * p->workers + w < oldest){
+                oldest = k * p->workers + w;
+                victim = w;
+            }
+        }
+        if(victim == SIZE_MAX){
+            return SIZE_MAX;
+        }
+        c = _ndjson_take(p, victim);
+    }
+    return c;
+}
+
+static int _ndjson_push(_ndjson_chunk_t* ch, const soa_ndjson_record_t* rec){
+    if(ch->size == ch->cap){
+        size_t cap = ch->cap ? ch->cap * 2 : 64;
+        soa_ndjson_record_t* records = realloc(ch->records, cap * sizeof(soa_ndjson_record_t));
+        if(!records){
+            return 0;
+        }
+        ch->records = records;
+        ch->cap = cap;
+    }
+    ch->records[ch->size++] = *rec;
+    return 1;
+}
+
+static void _ndjson_emit(_ndjson_job_t* p, soa_ndjson_record_t* rec){
+    if(atomic_load_explicit(&p->stop, memory_order_relaxed)){
+        soa_doc_free(&rec->doc);
+        return;
+    }
+    atomic_fetch_add_explicit(&p->delivered, 1, memory_order_relaxed);
+    if(p->opts.fn(p->opts.user, rec)){
+        atomic_store_explicit(&p->stop, 1, memory_order_relaxed);
+    }
+}
+
+// Whoever finds a chunk done delivers it and every done chunk after it.
+// A chunk finished while another thread delivers is picked up by that
+// thread's check after it lets go.
+static void _ndjson_deliver(_ndjson_job_t* p){
+    while(1){
+        int idle = 0;
+        if(!atomic_compare_exchange_strong(&p->delivering, &idle, 1)){
+            return;
+        }
+        while(p->deliver < p->chunk_count && atomic_load(&p->chunks[p->deliver].done)){
+            _ndjson_chunk_t* ch = p->chunks + p->deliver++;
+            for(size_t r = 0; r < ch->size; r++){
+                ch->records[r].index = p->index++;
+                _ndjson_emit(p, ch->records + r);
+            }
+            free(ch->records);
+            ch->records = NULL;
+            ch->size = 0;
+        }
+        size_t next = p->deliver;
+        atomic_store(&p->delivering, 0);
+        if(next == p->chunk_count || !atomic_load(&p->chunks[next].done)){
+            return;
+        }
+    }
+}
+
+static void _ndjson_parse_chunk(_ndjson_job_t* p, size_t c){
+    const char* ptr = p->data + p->bounds[c];
+    const char* end = p->data + p->bounds[c + 1];
+    _ndjson_chunk_t* ch = p->chunks + c;
+    int ordered = !(p->opts.flags & SOA_NDJSON_UNORDERED);
+
+    while(ptr < end && !atomic_load_explicit(&p->stop, memory_order_relaxed)){
+        const char* eol = memchr(ptr, '\n', end - ptr);
+        if(!eol){
+            eol = end;
+        }
+        if(!_ndjson_blank(ptr, eol)){
+            soa_ndjson_record_t rec = {
+                .index = SIZE_MAX,
+                .offset = ptr - p->data
+            };
+            rec.doc = soa_doc_new_from_json_alloc(ptr, eol - ptr, p->opts.parse_flags, p->opts.alloc, &rec.error);
+            if(rec.error.code){
+                rec.error.offset += rec.offset;
+            }
+            if(!ordered){
+                _ndjson_emit(p, &rec);
+            }
+            else if(!_ndjson_push(ch, &rec)){
+                soa_doc_free(&rec.doc);
+                atomic_store(&p->oom, 1);
+                atomic_store_explicit(&p->stop, 1, memory_order_relaxed);
+            }
+        }
+        ptr = eol + 1;
+    }
+
+    if(ordered){
+        atomic_store(&ch->done, 1);
+        _ndjson_deliver(p);
+    }
+}
+
+static void _ndjson_work(_ndjson_job_t* p, size_t worker){
+    size_t c;
+    while(!atomic_load_explicit(&p->stop, memory_order_relaxed) && (c = _ndjson_next(p, worker)) != SIZE_MAX){
+        _ndjson_parse_chunk(p, c);
+    }
+}
+
+static int _ndjson_thread(void* arg){
+    soa_ndjson_pool_t* pool = arg;
+    size_t seen = 0;
+    mtx_lock(&pool->lock);
+    while(1){
+        while(!pool->quit && (!pool->job || pool->generation == seen)){
+            cnd_wait(&pool->wake, &pool->lock);
+        }
+        if(pool->quit){
+            break;
+        }
+        seen = pool->generation;
+        _ndjson_job_t* p = pool->job;
+        if(pool->joined == p->workers){
+            continue;
+        }
+        size_t worker = pool->joined++;
+        pool->busy++;
+        mtx_unlock(&pool->lock);
+        _ndjson_work(p, worker);
+        mtx_lock(&pool->lock);
+        if(!--pool->busy){
+            cnd_signal(&pool->idle);
+        }
+    }
+    mtx_unlock(&pool->lock);
+    return 0;
+}
+
+soa_ndjson_pool_t* soa_ndjson_pool_new(size_t threads){
+    if(!threads){
+        threads = _ndjson_cpu_count();
+    }
+    soa_ndjson_pool_t* pool = calloc(1, sizeof(soa_ndjson_pool_t));
+    if(!pool){
+        return NULL;
+    }
+    pool->ids = malloc(threads * sizeof(thrd_t));
+    int synced = 0;
+    if(pool->ids){
+        synced = mtx_init(&pool->run, mtx_plain) == thrd_success;
+        synced += synced && mtx_init(&pool->lock, mtx_plain) == thrd_success;
+        synced += synced == 2 && cnd_init(&pool->wake) == thrd_success;
+        synced += synced == 3 && cnd_init(&pool->idle) == thrd_success;
+    }
+    if(synced < 4){
+        if(synced > 2) cnd_destroy(&pool->wake);
+        if(synced > 1) mtx_destroy(&pool->lock);
+        if(synced > 0) mtx_destroy(&pool->run);
+        free(pool->ids);
+        free(pool);
+        return NULL;
+    }
+    // the caller is a worker too, threads that fail to start are left out
+    while(pool->threads < threads - 1 && thrd_create(pool->ids + pool->threads, _ndjson_thread, pool) == thrd_success){
+        pool->threads++;
+    }
+    return pool;
+}
+
+void soa_ndjson_pool_free(soa_ndjson_pool_t* pool){
+    if(!pool){
+        return;
+    }
+    mtx_lock(&pool->lock);
+    pool->quit = 1;
+    cnd_broadcast(&pool->wake);
+    mtx_unlock(&pool->lock);
+    for(size_t t = 0; t < pool->threads; t++){
+        thrd_join(pool->ids[t], NULL);
+    }
+    cnd_destroy(&pool->idle);
+    cnd_destroy(&pool->wake);
+    mtx_destroy(&pool->lock);
+    mtx_destroy(&pool->run);
+    free(pool->ids);
+    free(pool);
+}
+
+static size_t _ndjson_run(soa_ndjson_pool_t* pool, const char* data, size_t len, soa_ndjson_opts_t opts){
+    size_t threads = pool->threads + 1;
+
+    size_t size = len / (threads * SOA_NDJSON_CHUNKS_PER_THREAD);
+    if(size < SOA_NDJSON_CHUNK_MIN){
+        size = SOA_NDJSON_CHUNK_MIN;
+    }
+    size_t chunk_count = (len + size - 1) / size;
+    size_t workers = threads < chunk_count ? threads : chunk_count;
+
+    _ndjson_job_t p = {
+        .data = data,
+        .opts = opts,
+        .bounds = malloc((chunk_count + 1) * sizeof(size_t)),
+        .chunks = calloc(chunk_count, sizeof(_ndjson_chunk_t)),
+        .chunk_count = chunk_count,
+        .queues = calloc(workers, sizeof(_ndjson_queue_t)),
+        .workers = workers
+    };
+    if(!p.bounds || !p.chunks || !p.queues){
+        free(p.queues);
+        free(p.chunks);
+        free(p.bounds);
+        soa_error_push("Out of memory!", 42);
+        return 0;
+    }
+
+    // chunks end after a newline, one swallowed by a long line stays empty
+    p.bounds[0] = 0;
+    for(size_t c = 1; c < chunk_count; c++){
+        size_t pos = c * size;
+        if(pos <= p.bounds[c - 1]){
+            p.bounds[c] = p.bounds[c - 1];
+            continue;
+        }
+        const char* eol = memchr(data + pos, '\n', len - pos);
+        p.bounds[c] = eol ? (size_t)(eol - data) + 1 : len;
+    }
+    p.bounds[chunk_count] = len;
+
+    for(size_t w = 0; w < workers; w++){
+        p.queues[w].end = (chunk_count - w + workers - 1) / workers;
+    }
+
+    mtx_lock(&pool->run);
+    if(workers > 1){
+        mtx_lock(&pool->lock);
+        pool->job = &p;
+        pool->generation++;
+        pool->joined = 1;
+        cnd_broadcast(&pool->wake);
+        mtx_unlock(&pool->lock);
+    }
+    _ndjson_work(&p, 0);
+    if(workers > 1){
+        mtx_lock(&pool->lock);
+        pool->job = NULL;
+        while(pool->busy){
+            cnd_wait(&pool->idle, &pool->lock);
+        }
+        mtx_unlock(&pool->lock);
+    }
+    mtx_unlock(&pool->run);
+
+    // left over after a stop
+    for(size_t c = 0; c < chunk_count; c++){
+        _ndjson_chunk_t* ch = p.chunks + c;
+        for(size_t r = 0; r < ch->size; r++){
+            soa_doc_free(&ch->records[r].doc);
+        }
+        free(ch->records);
+    }
+
+    free(p.queues);
+    free(p.chunks);
+    free(p.bounds);
+    if(atomic_load(&p.oom)){
+        soa_error_push("Out of memory!", 42);
+    }
+    return atomic_load(&p.delivered);
+}
+
+size_t soa_ndjson_parse(const char* data, size_t len, soa_ndjson_opts_t opts){
+    if(!opts.fn || !len){
+        return 0;
+    }
+    soa_ndjson_pool_t* pool = opts.pool ? opts.pool : soa_ndjson_pool_new(opts.threads);
+    if(!pool){
+        soa_error_push("Out of memory!", 42);
+        return 0;
+    }
+    size_t delivered = _ndjson_run(pool, data, len, opts);
+    if(!opts.pool){
+        soa_ndjson_pool_free(pool);
+    }
+    return delivered;
+}
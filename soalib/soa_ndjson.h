@@ -0,0 +1,95 @@
+/*
+MIT License
+
+Copyright (c) 2026 Błażej Dombek <blazejdombek@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#ifndef soa_ndjson_h
+#define soa_ndjson_h
+
+#ifdef __cplusplus
+extern "C" { 
+#endif
+
+#include "soa_json.h"
+
+// Smallest piece of input a worker parses at once
+#ifndef SOA_NDJSON_CHUNK_MIN
+#define SOA_NDJSON_CHUNK_MIN (64 * 1024)
+#endif
+
+// Input is cut into this many chunks per thread, more balances better
+#ifndef SOA_NDJSON_CHUNKS_PER_THREAD
+#define SOA_NDJSON_CHUNKS_PER_THREAD 8
+#endif
+
+typedef enum {
+    SOA_NDJSON_ORDERED = 0,
+    SOA_NDJSON_UNORDERED = 1
+} soa_ndjson_flag_bit_t;
+
+typedef uint32_t soa_ndjson_flags_t;
+
+typedef struct {
+    size_t index;      // record number in input order, SIZE_MAX when unordered
+    size_t offset;     // byte offset of the record in the input
+    soa_doc_t doc;     // belongs to the callback, empty on error
+    soa_error_t error; // offset counts from the start of the input
+} soa_ndjson_record_t;
+
+// Return non zero to stop, records that were not delivered are freed
+typedef int (*soa_ndjson_fn)(void* user, soa_ndjson_record_t* record);
+
+// Worker threads kept between parses. One parse runs on a pool at a time,
+// others wait for it, so callbacks must not parse on their own pool.
+typedef struct soa_ndjson_pool soa_ndjson_pool_t;
+
+// threads counts the thread calling soa_ndjson_parse, 0 uses every core.
+// Returns NULL when out of memory.
+soa_ndjson_pool_t* soa_ndjson_pool_new(size_t threads);
+void soa_ndjson_pool_free(soa_ndjson_pool_t* pool);
+
+typedef struct {
+    soa_ndjson_fn fn;
+    void* user;
+    soa_json_parse_flags_t parse_flags;
+    soa_ndjson_flags_t flags;
+    size_t threads; // 0 uses every core
+    const soa_allocator_t* alloc; // of the docs, called from the worker threads
+    soa_ndjson_pool_t* pool; // runs on it instead of starting threads, threads is ignored
+} soa_ndjson_opts_t;
+
+// Parses one json document per line, blank lines are skipped. Ordered
+// callbacks come one at a time in input order, unordered ones come from
+// the worker threads as soon as a record is ready and have to be thread
+// safe. A record that fails is delivered with its error, the rest go on.
+// With SOA_JSON_INSITU docs borrow from data. The size limit of soa_json.h
+// is per line.
+// Returns number of records delivered. Running out of memory stops the
+// parse and leaves 42 "Out of memory!" as the thread's last error.
+size_t soa_ndjson_parse(const char* data, size_t len, soa_ndjson_opts_t opts);
+
+#ifdef __cplusplus
+} 
+#endif
+
+#endif
@@ -0,0 +1,350 @@
+/*
+MIT License
+
+Copyright (c) 2026 Błażej Dombek <blazejdombek@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "soa_path.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Paths compile to steps with their keys unescaped and hashed, so
+// evaluating one is a key lookup or an index per step and nothing else.
+// Keys are kept behind the steps in the same allocation.
+
+typedef enum {
+    _PATH_KEY = 0,   // object key, numeric keys also index arrays
+    _PATH_INDEX = 1, // [n], arrays only
+    _PATH_ANY = 2    // every member
+} _path_kind_t;
+
+typedef struct {
+    const char* key;
+    size_t len;
+    size_t index; // SIZE_MAX when the step never matches arrays
+    uint32_t hash;
+    uint8_t kind;
+} _path_step_t;
+
+struct soa_path {
+    size_t count;
+    int wild;
+    _path_step_t steps[];
+};
+
+typedef struct {
+    _path_step_t* steps; // NULL while counting
+    char* keys;
+    size_t count;
+    size_t bytes;
+    int wild;
+} _path_build_t;
+
+inline static void _path_key_char(_path_build_t* b, char c){
+    if(b->keys){
+        b->keys[b->bytes] = c;
+    }
+    b->bytes++;
+}
+
+// Canonical array index, no sign and no leading zeros
+static size_t _path_index(const char* s, size_t n){
+    if(!n || n > 19 || (s[0] == '0' && n > 1)){
+        return SIZE_MAX;
+    }
+    size_t v = 0;
+    for (size_t i = 0; i < n; i++) {
+        if(s[i] < '0' || s[i] > '9'){
+            return SIZE_MAX;
+        }
+        v = v * 10 + (size_t)(s[i] - '0');
+    }
+    return v;
+}
+
+// Ends the step whose key bytes start at key
+static void _path_step(_path_build_t* b, uint8_t kind, size_t key, size_t index){
+    b->wild |= kind == _PATH_ANY;
+    if(b->steps){
+        _path_step_t* s = &b->steps[b->count];
+        s->kind = kind;
+        s->key = b->keys + key;
+        s->len = b->bytes - key;
+        s->hash = soa_key_hash(s->key, s->len);
+        s->index = index;
+    }
+    b->count++;
+}
+
+inline static int _path_error(soa_error_t* error, const char* msg, int code, size_t offset){
+    if(error){
+        *error = (soa_error_t){msg, code, offset};
+    }
+    return 0;
+}
+
+// "/a/~1b/*"
+static int _path_pointer(_path_build_t* b, const char* p, size_t len, soa_error_t* error){
+    size_t pos = 0;
+    while(pos < len){
+        pos++; // '/'
+        size_t key = b->bytes;
+        size_t start = pos;
+        for(; pos < len && p[pos] != '/'; pos++){
+            if(p[pos] != '~'){
+                _path_key_char(b, p[pos]);
+                continue;
+            }
+            if(pos + 1 == len || (p[pos + 1] != '0' && p[pos + 1] != '1')){
+                return _path_error(error, "Invalid escape in path!", 61, pos);
+            }
+            _path_key_char(b, p[++pos] == '0' ? '~' : '/');
+        }
+        if(pos - start == 1 && p[start] == '*'){
+            _path_step(b, _PATH_ANY, key, SIZE_MAX);
+        }
+        else{
+            // escapes are never digits, the raw token tells
+            _path_step(b, _PATH_KEY, key, _path_index(p + start, pos - start));
+        }
+    }
+    return 1;
+}
+
+// "$.a.b[0]['c.d'][*]"
+static int _path_dotted(_path_build_t* b, const char* p, size_t len, soa_error_t* error){
+    size_t pos = 0;
+    int dot = 0; // a bare key needs a '.' before it
+    if(len && p[0] == '$'){
+        pos++;
+        dot = 1;
+    }
+    while(pos < len){
+        size_t key = b->bytes;
+        if(p[pos] == '['){
+            pos++;
+            if(pos < len && p[pos] == '*'){
+                pos++;
+                _path_step(b, _PATH_ANY, key, SIZE_MAX);
+            }
+            else if(pos < len && (p[pos] == '"' || p[pos] == '\'')){
+                char quote = p[pos++];
+                for(; pos < len && p[pos] != quote; pos++){
+                    if(p[pos] == '\\' && ++pos == len){
+                        break;
+                    }
+                    _path_key_char(b, p[pos]);
+                }
+                if(pos++ == len){
+                    return _path_error(error, "Key not terminated in path!", 62, len);
+                }
+                // quoted keys never index arrays
+                _path_step(b, _PATH_KEY, key, SIZE_MAX);
+            }
+            else{
+                size_t start = pos;
+                while(pos < len && p[pos] >= '0' && p[pos] <= '9'){
+                    _path_key_char(b, p[pos++]);
+                }
+                size_t index = _path_index(p + start, pos - start);
+                if(index == SIZE_MAX){
+                    return _path_error(error, "Invalid index in path!", 63, start);
+                }
+                _path_step(b, _PATH_INDEX, key, index);
+            }
+            if(pos == len || p[pos] != ']'){
+                return _path_error(error, "Expected ] in path!", 64, pos);
+            }
+            pos++;
+            dot = 1;
+            continue;
+        }
+        if(dot){
+            if(p[pos] != '.'){
+                return _path_error(error, "Expected . or [ in path!", 64, pos);
+            }
+            pos++;
+        }
+        size_t start = pos;
+        for(; pos < len && p[pos] != '.' && p[pos] != '['; pos++){
+            _path_key_char(b, p[pos]);
+        }
+        if(pos == start){
+            return _path_error(error, "Empty key in path!", 65, pos);
+        }
+        if(pos - start == 1 && p[start] == '*'){
+            _path_step(b, _PATH_ANY, key, SIZE_MAX);
+        }
+        else{
+            _path_step(b, _PATH_KEY, key, _path_index(p + start, pos - start));
+        }
+        dot = 1;
+    }
+    return 1;
+}
+
+static int _path_parse(_path_build_t* b, const char* path, size_t len, soa_error_t* error){
+    if(len && path[0] == '/'){
+        return _path_pointer(b, path, len, error);
+    }
+    return _path_dotted(b, path, len, error);
+}
+
+soa_path_t* soa_path_new(const char* path, size_t len, soa_error_t* error){
+    _path_build_t b = {0};
+    if(!_path_parse(&b, path, len, error)){
+        return NULL;
+    }
+    if(!b.count){
+        _path_error(error, "Path has no steps!", 66, 0);
+        return NULL;
+    }
+
+    soa_path_t* p = malloc(sizeof(soa_path_t) + b.count * sizeof(_path_step_t) + b.bytes);
+    if(!p){
+        _path_error(error, "Out of memory!", 67, 0);
+        return NULL;
+    }
+    p->count = b.count;
+    p->wild = b.wild;
+    b = (_path_build_t){.steps = p->steps, .keys = (char*)(p->steps + p->count)};
+    _path_parse(&b, path, len, error);
+    _path_error(error, NULL, 0, 0);
+    return p;
+}
+
+void        soa_path_free(soa_path_t* path){
+    free(path);
+}
+
+// Member of the container at data that step s picks, 0 when there is none
+static int _path_child(const _path_step_t* s, soa_doc_t* doc, soa_type_t type, size_t data, soa_val_t* out){
+    if(type == SOA_TYPE_OBJ && s->kind != _PATH_INDEX){
+        soa_obj_t obj = {doc, data};
+        *out = soa_obj_val_at_index(&obj, _soa_obj_find_key_hash(&obj, s->key, s->len, s->hash));
+        return out->doc != NULL;
+    }
+    if(type == SOA_TYPE_ARR && s->index != SIZE_MAX){
+        soa_arr_t arr = {doc, data};
+        *out = soa_arr_val_at(&arr, s->index);
+        return out->doc != NULL;
+    }
+    return 0;
+}
+
+// Type and offset of the container val holds, 0 for scalars
+static int _path_container(soa_val_t* val, soa_type_t* type, size_t* data){
+    *type = soa_val_type(val);
+    if(*type == SOA_TYPE_OBJ){
+        *data = soa_val_obj(val).data;
+        return 1;
+    }
+    if(*type == SOA_TYPE_ARR){
+        *data = soa_val_arr(val).data;
+        return 1;
+    }
+    return 0;
+}
+
+// Roots move like any container when they grow
+inline static size_t _path_root(soa_doc_t* doc){
+    return doc->root_type == SOA_ROOT_OBJ ? soa_doc_root_obj(doc).data : soa_doc_root_arr(doc).data;
+}
+
+typedef struct {
+    soa_path_fn fn;
+    void* user;
+    size_t found;
+    int stop;
+} _path_walk_t;
+
+static void _path_walk(const soa_path_t* path, size_t step, soa_doc_t* doc, soa_type_t type, size_t data, _path_walk_t* w);
+
+static void _path_visit(const soa_path_t* path, size_t step, soa_val_t* val, _path_walk_t* w){
+    if(step == path->count){
+        w->found++;
+        w->stop = w->fn(w->user, val) != 0;
+        return;
+    }
+    soa_type_t type;
+    size_t data;
+    if(_path_container(val, &type, &data)){
+        _path_walk(path, step, val->doc, type, data, w);
+    }
+}
+
+static void _path_walk(const soa_path_t* path, size_t step, soa_doc_t* doc, soa_type_t type, size_t data, _path_walk_t* w){
+    const _path_step_t* s = &path->steps[step];
+    soa_val_t val;
+    if(s->kind != _PATH_ANY){
+        if(_path_child(s, doc, type, data, &val)){
+            _path_visit(path, step + 1, &val, w);
+        }
+        return;
+    }
+    if(type == SOA_TYPE_OBJ){
+        soa_obj_t obj = {doc, data};
+        size_t length = soa_obj_length(&obj);
+        for (size_t i = 0; i < length && !w->stop; i++) {
+            val = soa_obj_val_at_index(&obj, i);
+            _path_visit(path, step + 1, &val, w);
+        }
+    }
+    else if(type == SOA_TYPE_ARR){
+        soa_arr_t arr = {doc, data};
+        size_t length = soa_arr_length(&arr);
+        for (size_t i = 0; i < length && !w->stop; i++) {
+            val = soa_arr_val_at(&arr, i);
+            _path_visit(path, step + 1, &val, w);
+        }
+    }
+}
+
+size_t      soa_path_each(const soa_path_t* path, soa_doc_t* doc, soa_path_fn fn, void* user){
+    _path_walk_t w = {fn, user, 0, 0};
+    if(doc->root_type){
+        _path_walk(path, 0, doc, doc->root_type, _path_root(doc), &w);
+    }
+    return w.found;
+}
+
+static int _path_first(void* user, soa_val_t* val){
+    *(soa_val_t*)user = *val;
+    return 1;
+}
+
+int         soa_path_get(const soa_path_t* path, soa_doc_t* doc, soa_val_t* out){
+    if(path->wild){
+        return soa_path_each(path, doc, _path_first, out) != 0;
+    }
+    soa_type_t type = doc->root_type;
+    size_t data = _path_root(doc);
+    for (size_t i = 0; i < path->count; i++) {
+        if(!_path_child(&path->steps[i], doc, type, data, out)){
+            return 0;
+        }
+        if(i + 1 < path->count && !_path_container(out, &type, &data)){
+            return 0;
+        }
+    }
+    return 1;
+}
@@ -0,0 +1,61 @@
+/*
+MIT License
+
+Copyright (c) 2026 Błażej Dombek <blazejdombek@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef soa_path_h
+#define soa_path_h
+
+#ifdef __cplusplus
+extern "C" { 
+#endif
+
+#include "soa.h"
+
+// Compiled path, read only once made so any number of threads can share it
+typedef struct soa_path soa_path_t;
+
+// Takes a JSON Pointer, "/a/0/b" with ~0 for '~' and ~1 for '/', or the
+// dotted form a.b[0].c with an optional leading '$' and ["key"] for keys
+// holding any of .[]"\. A '*' step, or [*], matches every member of an
+// object or array. Numeric steps other than [n] also match object keys.
+// Paths need at least one step, the root is no value. Returns NULL on
+// error, error.offset is where in path it failed.
+soa_path_t* soa_path_new(const char* path, size_t len, soa_error_t* error);
+void        soa_path_free(soa_path_t* path);
+
+// Writes the first match in document order to out, returns 0 when nothing
+// matches. Looking up keys of large objects can build their index, see
+// soa_obj_find_key.
+int         soa_path_get(const soa_path_t* path, soa_doc_t* doc, soa_val_t* out);
+
+// Return non zero to stop, the doc must not change during the walk
+typedef int (*soa_path_fn)(void* user, soa_val_t* val);
+
+// Calls fn with every match in document order, returns matches delivered
+size_t      soa_path_each(const soa_path_t* path, soa_doc_t* doc, soa_path_fn fn, void* user);
+
+#ifdef __cplusplus
+} 
+#endif
+
+#endif
@@ -6,6 +6,7 @@
 
 #include "soalib/soa.hpp"
 #include "soalib/soa_json.hpp"
+#include "tests.h"
 
 struct point {
     double x, y;
@@ -28,6 +29,10 @@ struct std::formatter<point>{
 };
 
 int main(){
+    if(int failed = test_compact() + test_lookup() + test_snapshot() + test_edit() + test_ndjson() + test_serialize()){
+        std::print("{} checks failed\n", failed);
+        return 1;
+    }
     {
         std::string json = "{\"test\":123, \"helo\":\"word\", \"p2\": { \"x\": 69.67, \"z\": 420}"
         "\"test_vec\": [10,9,8,7,6,5,4,3]}";
@@ -0,0 +1,362 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "soalib/soa.h"
+#include "soalib/soa_json.h"
+#include "tests.h"
+
+static const char* s_docs[] = {
+    // packed singles leave the array region 4 bytes short of a word
+    "{\"a\":[1.5,2.5,3.5],\"b\":\"abcdefghijklmnopqrstuvwxyz0123\",\"c\":[1.25]}",
+    "{\"name\":\"a string long enough to live in the doc\",\"list\":[1,-2,3],"
+    "\"u\":[18446744073709551615,1],\"f\":[0.5,0.25],\"mixed\":[1,\"two\",true,null,{\"k\":[]}],"
+    "\"empty\":{},\"ea\":[],\"esc\":\"tab\\tquote\\\"slash\\/\"}",
+    "[[1.5],[2.5,3.5,4.5],{\"x\":\"abcdefghijklmnopqrstuvwxyz\"},\"abcdefghijklmnopqrstuvwxyz\",[]]",
+    "{\"k0\":0,\"k1\":\"value number one that is long\",\"k2\":[1,2],\"k3\":3,\"k4\":4,\"k5\":5,"
+    "\"k6\":6,\"k7\":7,\"k8\":8,\"k9\":9,\"k10\":10,\"k11\":11,\"k12\":12,\"k13\":13,\"k14\":14,"
+    "\"k15\":15,\"k16\":16,\"k17\":[0.5],\"k18\":{\"k19\":\"value number nineteen that is long\"}}"
+};
+
+static char* _print(soa_doc_t* doc){
+    return soa_json_new_from_doc(doc, SOA_JSON_NONE);
+}
+
+// Fails once the allocations left run out
+static void* _oom_alloc(void* user, size_t size){
+    int* left = user;
+    return (*left)-- > 0 ? malloc(size) : NULL;
+}
+
+static void* _oom_realloc(void* user, void* ptr, size_t old_size, size_t size){
+    (void)old_size;
+    int* left = user;
+    return (*left)-- > 0 ? realloc(ptr, size) : NULL;
+}
+
+static void _oom_free(void* user, void* ptr, size_t size){
+    (void)user;
+    (void)size;
+    free(ptr);
+}
+
+// Compaction out of memory at each allocation in turn leaves the doc as it was
+static int _compact_oom(void){
+    int failed = 0;
+    // more containers than the first compaction stack holds
+    char json[512] = "[";
+    for (int i = 0; i < 100; i++) {
+        strcat(json, i ? ",[1]" : "[1]");
+    }
+    strcat(json, "]");
+    int left = 0;
+    soa_allocator_t alloc = {_oom_alloc, _oom_realloc, _oom_free, &left};
+    for (int fail_at = 0;; fail_at++) {
+        left = 1 << 20;
+        soa_error_t e;
+        soa_doc_t doc = soa_doc_new_from_json_alloc(json, strlen(json), SOA_JSON_NONE, &alloc, &e);
+        CHECK(!e.code);
+        char* before = _print(&doc);
+        uint8_t* data = doc.data;
+        soa_error_pop();
+        left = fail_at;
+        soa_doc_compact(&doc, SOA_COMPACT_GROUPED);
+        left = 1 << 20;
+        int oom = soa_error_get().code == 42;
+        CHECK(!oom || doc.data == data);
+        char* after = _print(&doc);
+        CHECK(strcmp(before, after) == 0);
+        free(before);
+        free(after);
+        soa_doc_free(&doc);
+        if(!oom){
+            break;
+        }
+    }
+    return failed;
+}
+
+int test_compact(void){
+    int failed = _compact_oom();
+    soa_json_parse_flags_t parse_flags[] = {SOA_JSON_NONE, SOA_JSON_INDEX_KEYS, SOA_JSON_INSITU};
+    for (size_t d = 0; d < sizeof(s_docs) / sizeof(*s_docs); d++) {
+        for (size_t p = 0; p < sizeof(parse_flags) / sizeof(*parse_flags); p++) {
+            // every combination of order, columns, packing and singles
+            for (soa_compact_t layout = 0; layout < 16; layout++) {
+                soa_error_t e;
+                soa_doc_t doc = soa_doc_new_from_json_n(s_docs[d], strlen(s_docs[d]), parse_flags[p], &e);
+                CHECK(!e.code);
+                char* before = _print(&doc);
+                soa_doc_compact(&doc, layout);
+                char* after = _print(&doc);
+                CHECK(strcmp(before, after) == 0);
+                // compacting a compacted doc changes nothing either
+                soa_doc_compact(&doc, layout);
+                char* again = _print(&doc);
+                CHECK(strcmp(before, again) == 0);
+                if(doc.root_type == SOA_ROOT_OBJ){
+                    soa_obj_t root = soa_doc_root_obj(&doc);
+                    size_t len = soa_obj_length(&root);
+                    size_t key_len;
+                    const char* key = soa_obj_key_at_n(&root, len - 1, &key_len);
+                    CHECK(soa_obj_find_key(&root, key, key_len) == len - 1);
+                }
+                free(before);
+                free(after);
+                free(again);
+                soa_doc_free(&doc);
+            }
+        }
+    }
+    return failed;
+}
+
+int test_lookup(void){
+    int failed = 0;
+    const char* json = s_docs[3];
+    soa_error_t e;
+    soa_doc_t doc = soa_doc_new_from_json_n(json, strlen(json), SOA_JSON_NONE, &e);
+    CHECK(!e.code);
+    for (int indexed = 0; indexed < 2; indexed++) {
+        // lookups never write to the doc, indexed or not
+        uint8_t* data = doc.data;
+        size_t size = doc.size;
+        soa_obj_t root = soa_doc_root_obj(&doc);
+        size_t len = soa_obj_length(&root);
+        CHECK(len >= SOA_OBJ_INDEX_THRESHOLD);
+        for (size_t i = 0; i < len; i++) {
+            size_t key_len;
+            const char* key = soa_obj_key_at_n(&root, i, &key_len);
+            CHECK(soa_obj_find_key(&root, key, key_len) == i);
+        }
+        CHECK(soa_obj_find_key(&root, "missing", 7) == len);
+        CHECK(doc.data == data && doc.size == size);
+        soa_doc_build_index(&doc);
+    }
+    soa_doc_free(&doc);
+    return failed;
+}
+
+static const char* s_snapshot = "test_snapshot.snap";
+
+static void _write_file(const char* path, const uint8_t* data, size_t size){
+    FILE* file = fopen(path, "wb");
+    fwrite(data, 1, size, file);
+    fclose(file);
+}
+
+static uint8_t* _read_file(const char* path, size_t* size){
+    FILE* file = fopen(path, "rb");
+    fseek(file, 0, SEEK_END);
+    *size = (size_t)ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t* data = malloc(*size);
+    *size = fread(data, 1, *size, file);
+    fclose(file);
+    return data;
+}
+
+// Loads the file and returns the error code, a doc that loads has to print
+static int _load(const uint8_t* data, size_t size, soa_snapshot_flags_t flags){
+    _write_file(s_snapshot, data, size);
+    soa_error_t e;
+    soa_doc_t doc = soa_doc_load_mmap(s_snapshot, flags, &e);
+    if(!e.code){
+        free(_print(&doc));
+    }
+    soa_doc_free(&doc);
+    return e.code;
+}
+
+int test_snapshot(void){
+    int failed = 0;
+    for (size_t d = 0; d < sizeof(s_docs) / sizeof(*s_docs); d++) {
+        soa_error_t e;
+        soa_doc_t doc = soa_doc_new_from_json_n(s_docs[d], strlen(s_docs[d]), SOA_JSON_NONE, &e);
+        CHECK(!e.code);
+        char* before = _print(&doc);
+        CHECK(soa_doc_save(&doc, s_snapshot, &e) && !e.code);
+        soa_doc_free(&doc);
+
+        soa_doc_t loaded = soa_doc_load_mmap(s_snapshot, SOA_SNAPSHOT_CHECKSUM | SOA_SNAPSHOT_VALIDATE, &e);
+        CHECK(!e.code);
+        char* after = _print(&loaded);
+        CHECK(strcmp(before, after) == 0);
+        // lookups go through the index saved with it
+        soa_obj_t root = soa_doc_root_obj(&loaded);
+        if(loaded.root_type == SOA_ROOT_OBJ){
+            size_t key_len;
+            const char* key = soa_obj_key_at_n(&root, 0, &key_len);
+            CHECK(soa_obj_find_key(&root, key, key_len) == 0);
+        }
+        soa_doc_free(&loaded);
+        free(before);
+        free(after);
+
+        size_t size;
+        uint8_t* file = _read_file(s_snapshot, &size);
+        soa_snapshot_header_t header;
+        memcpy(&header, file, sizeof(header));
+        uint8_t* corrupt = malloc(size);
+
+        CHECK(_load(file, sizeof(header) - 1, SOA_SNAPSHOT_NONE) == 52);
+        CHECK(_load(file, size - 1, SOA_SNAPSHOT_NONE) == 52);
+
+        memcpy(corrupt, file, size);
+        corrupt[0] ^= 1;
+        CHECK(_load(corrupt, size, SOA_SNAPSHOT_NONE) == 52);
+
+        // a root off the word boundary is caught before anything reads it
+        soa_snapshot_header_t h = header;
+        h.root += 1;
+        memcpy(corrupt, &h, sizeof(h));
+        CHECK(_load(corrupt, size, SOA_SNAPSHOT_VALIDATE) == 54);
+
+        // every byte of the doc flipped in turn, the checksum catches all of
+        // them and validation whatever would be read out of bounds
+        for (size_t i = sizeof(header); i < size; i++) {
+            memcpy(corrupt, file, size);
+            corrupt[i] ^= (uint8_t)(1 << (i % 8));
+            CHECK(_load(corrupt, size, SOA_SNAPSHOT_CHECKSUM) == 53);
+            int code = _load(corrupt, size, SOA_SNAPSHOT_VALIDATE);
+            CHECK(code == 0 || code == 54);
+        }
+        free(corrupt);
+        free(file);
+    }
+    remove(s_snapshot);
+    return failed;
+}
+
+static uint32_t s_rand = 1;
+
+static uint32_t _rand(void){
+    s_rand = s_rand * 1103515245u + 12345u;
+    return s_rand >> 8;
+}
+
+static void _key(char* key, int id){
+    // every third key too long to be stored in the entry
+    sprintf(key, id % 3 ? "k%d" : "key number %d", id);
+}
+
+// Random pushes, inserts and erases on an array and an object, checked
+// against plain arrays after every step. Both sit in the middle of the doc
+// so they have to move to grow, and compaction runs now and then.
+int test_edit(void){
+    int failed = 0;
+    const char* json = "{\"a\":[1,2,3],\"o\":{\"k1\":1,\"k2\":2},\"b\":[0.5,1.5],\"s\":\"a string long enough to live in the doc\"}";
+    soa_json_parse_flags_t parse_flags[] = {
+        SOA_JSON_NONE, SOA_JSON_COLUMNS, SOA_JSON_PACK_NUMBERS, SOA_JSON_INDEX_KEYS,
+        SOA_JSON_COLUMNS | SOA_JSON_PACK_NUMBERS | SOA_JSON_INDEX_KEYS
+    };
+    enum { MAX = 256 };
+    for (size_t p = 0; p < sizeof(parse_flags) / sizeof(*parse_flags); p++) {
+        soa_error_t e;
+        soa_doc_t doc = soa_doc_new_from_json_n(json, strlen(json), parse_flags[p], &e);
+        CHECK(!e.code);
+        int64_t arr[MAX] = {1, 2, 3};
+        size_t arr_len = 3;
+        int keys[MAX] = {1, 2};
+        size_t obj_len = 2;
+        int next = 3;
+
+        for (int step = 0; step < 600; step++) {
+            soa_obj_t root = soa_doc_root_obj(&doc);
+            soa_val_t va = soa_obj_val_at_key(&root, "a");
+            soa_arr_t a = soa_val_arr(&va);
+            soa_val_t vo = soa_obj_val_at_key(&root, "o");
+            soa_obj_t o = soa_val_obj(&vo);
+            char key[32];
+            size_t at;
+            switch(_rand() % 7){
+            case 0:
+                if(arr_len < MAX){
+                    soa_val_t v = soa_arr_push(&a);
+                    arr[arr_len] = next++;
+                    soa_val_set_int(&v, arr[arr_len++]);
+                }
+                break;
+            case 1:
+                if(arr_len < MAX){
+                    at = _rand() % (arr_len + 1);
+                    soa_val_t v = soa_arr_insert(&a, at);
+                    memmove(arr + at + 1, arr + at, (arr_len++ - at) * sizeof(*arr));
+                    arr[at] = next++;
+                    soa_val_set_int(&v, arr[at]);
+                }
+                break;
+            case 2:
+                if(arr_len){
+                    at = _rand() % arr_len;
+                    soa_arr_erase(&a, at);
+                    memmove(arr + at, arr + at + 1, (--arr_len - at) * sizeof(*arr));
+                }
+                break;
+            case 3:
+                if(obj_len < MAX){
+                    _key(key, next);
+                    soa_val_t v = soa_obj_push(&o, key, strlen(key));
+                    keys[obj_len++] = next;
+                    soa_val_set_int(&v, next++);
+                }
+                break;
+            case 4:
+                if(obj_len < MAX){
+                    at = _rand() % (obj_len + 1);
+                    _key(key, next);
+                    soa_val_t v = soa_obj_insert(&o, at, key, strlen(key));
+                    memmove(keys + at + 1, keys + at, (obj_len++ - at) * sizeof(*keys));
+                    keys[at] = next;
+                    soa_val_set_int(&v, next++);
+                }
+                break;
+            case 5:
+                if(obj_len){
+                    at = _rand() % obj_len;
+                    soa_obj_erase(&o, at);
+                    memmove(keys + at, keys + at + 1, (--obj_len - at) * sizeof(*keys));
+                }
+                break;
+            default:
+                soa_doc_compact(&doc, (soa_compact_t)(_rand() % 16));
+                break;
+            }
+
+            root = soa_doc_root_obj(&doc);
+            va = soa_obj_val_at_key(&root, "a");
+            a = soa_val_arr(&va);
+            vo = soa_obj_val_at_key(&root, "o");
+            o = soa_val_obj(&vo);
+            CHECK(soa_arr_length(&a) == arr_len);
+            for (size_t i = 0; i < arr_len && i < soa_arr_length(&a); i++) {
+                soa_val_t v = soa_arr_val_at(&a, i);
+                // parsed values are unsigned, set ones signed
+                CHECK((soa_val_type(&v) == SOA_TYPE_INT || soa_val_type(&v) == SOA_TYPE_UINT) && soa_val_int(&v) == arr[i]);
+            }
+            CHECK(soa_obj_length(&o) == obj_len);
+            for (size_t i = 0; i < obj_len && i < soa_obj_length(&o); i++) {
+                _key(key, keys[i]);
+                size_t key_len;
+                const char* k = soa_obj_key_at_n(&o, i, &key_len);
+                CHECK(key_len == strlen(key) && memcmp(k, key, key_len) == 0);
+                CHECK(soa_obj_find_key(&o, key, key_len) == i);
+                soa_val_t v = soa_obj_val_at_index(&o, i);
+                CHECK(soa_val_int(&v) == keys[i]);
+            }
+            if(failed){
+                break;
+            }
+        }
+
+        // the neighbours stay as they were
+        soa_obj_t root = soa_doc_root_obj(&doc);
+        soa_val_t vb = soa_obj_val_at_key(&root, "b");
+        soa_arr_t b = soa_val_arr(&vb);
+        soa_val_t b1 = soa_arr_val_at(&b, 1);
+        CHECK(soa_arr_length(&b) == 2 && soa_val_float(&b1) == 1.5);
+        soa_val_t s = soa_obj_val_at_key(&root, "s");
+        CHECK(strcmp(soa_val_str(&s), "a string long enough to live in the doc") == 0);
+        soa_doc_free(&doc);
+    }
+    return failed;
+}
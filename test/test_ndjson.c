@@ -0,0 +1,68 @@
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "soalib/soa.h"
+#include "soalib/soa_ndjson.h"
+#include "tests.h"
+
+typedef struct {
+    atomic_size_t sum;
+    atomic_int failed;
+} _lines_t;
+
+static int _line(void* user, soa_ndjson_record_t* record){
+    _lines_t* l = user;
+    if(record->error.code || record->doc.root_type != SOA_ROOT_OBJ){
+        l->failed++;
+    }
+    else{
+        soa_obj_t root = soa_doc_root_obj(&record->doc);
+        soa_val_t v = soa_obj_val_at_key(&root, "i");
+        size_t i = (size_t)soa_val_int(&v);
+        if(record->index != SIZE_MAX && record->index != i){
+            atomic_fetch_add(&l->failed, 1);
+        }
+        atomic_fetch_add(&l->sum, i);
+    }
+    soa_doc_free(&record->doc);
+    return 0;
+}
+
+int test_ndjson(void){
+    int failed = 0;
+    // enough lines for several chunks per thread
+    size_t lines = 40000;
+    char* data = malloc(lines * 32);
+    size_t len = 0;
+    for (size_t i = 0; i < lines; i++) {
+        len += (size_t)sprintf(data + len, "{\"i\":%zu,\"s\":\"line\"}\n", i);
+    }
+    size_t sum = lines * (lines - 1) / 2;
+
+    soa_ndjson_pool_t* pool = soa_ndjson_pool_new(4);
+    CHECK(pool);
+    // the same workers take every parse, the last one without a pool
+    for (int run = 0; run < 9; run++) {
+        _lines_t l = {0, 0};
+        soa_ndjson_opts_t opts = {
+            .fn = _line,
+            .user = &l,
+            .flags = run % 2 ? SOA_NDJSON_UNORDERED : SOA_NDJSON_ORDERED,
+            .threads = 3,
+            .pool = run < 8 ? pool : NULL
+        };
+        CHECK(soa_ndjson_parse(data, len, opts) == lines);
+        CHECK(l.sum == sum);
+        CHECK(!l.failed);
+    }
+    // one chunk, the pool threads sleep through it
+    _lines_t l = {0, 0};
+    soa_ndjson_opts_t opts = {.fn = _line, .user = &l, .pool = pool};
+    const char* two = "{\"i\":0}\n\n{\"i\":1}";
+    CHECK(soa_ndjson_parse(two, strlen(two), opts) == 2);
+    CHECK(l.sum == 1 && !l.failed);
+    soa_ndjson_pool_free(pool);
+    free(data);
+    return failed;
+}
@@ -0,0 +1,198 @@
+#include <cstring>
+#include <map>
+#include <vector>
+
+#include "soalib/soa.hpp"
+#include "soalib/soa_json.hpp"
+#include "tests.h"
+
+namespace {
+
+// Fields declared out of position order, positions 0 and 2 have none
+struct spaced {
+    int x = 0;
+    soa::string y;
+
+    SOA_SERIALIZE_FIELD_BEGIN_ARR(4)
+    SOA_ARR_FIELD(y, 3);
+    SOA_ARR_FIELD(x, 1);
+    SOA_SERIALIZE_FILED_END()
+
+    bool operator==(const spaced&) const = default;
+};
+
+struct record {
+    int64_t id = 0;
+    double score = 0;
+    bool ok = false;
+    soa::string name;
+    std::vector<int> list;
+    spaced s;
+    soa::string note;
+
+    SOA_SERIALIZE_FIELD_BEGIN_OBJ(6, 7)
+    SOA_OBJ_FIELD(id, "id");
+    SOA_OBJ_FIELD(score, "score");
+    SOA_OBJ_FIELD(ok, "ok");
+    SOA_OBJ_FIELD(name, "name");
+    SOA_OBJ_FIELD(list, "list");
+    SOA_OBJ_FIELD(s, "s");
+    SOA_OBJ_OPT_FIELD(note, "note");
+    SOA_SERIALIZE_FILED_END()
+
+    bool operator==(const record&) const = default;
+};
+
+// More required fields than fit the first 64 bits of seen
+struct wide {
+    int f0 = 0, f1 = 0, f2 = 0, f3 = 0, f4 = 0, f5 = 0, f6 = 0, f7 = 0, f8 = 0, f9 = 0, f10 = 0, f11 = 0, f12 = 0, f13 = 0, f14 = 0, f15 = 0, f16 = 0, f17 = 0, f18 = 0, f19 = 0, f20 = 0, f21 = 0, f22 = 0, f23 = 0, f24 = 0, f25 = 0, f26 = 0, f27 = 0, f28 = 0, f29 = 0, f30 = 0, f31 = 0, f32 = 0, f33 = 0, f34 = 0, f35 = 0, f36 = 0, f37 = 0, f38 = 0, f39 = 0, f40 = 0, f41 = 0, f42 = 0, f43 = 0, f44 = 0, f45 = 0, f46 = 0, f47 = 0, f48 = 0, f49 = 0, f50 = 0, f51 = 0, f52 = 0, f53 = 0, f54 = 0, f55 = 0, f56 = 0, f57 = 0, f58 = 0, f59 = 0, f60 = 0, f61 = 0, f62 = 0, f63 = 0, f64 = 0, f65 = 0, f66 = 0, f67 = 0, f68 = 0, f69 = 0;
+
+    SOA_SERIALIZE_FIELD_BEGIN_OBJ(70, 70)
+    SOA_OBJ_FIELD(f0, "f0");
+    SOA_OBJ_FIELD(f1, "f1");
+    SOA_OBJ_FIELD(f2, "f2");
+    SOA_OBJ_FIELD(f3, "f3");
+    SOA_OBJ_FIELD(f4, "f4");
+    SOA_OBJ_FIELD(f5, "f5");
+    SOA_OBJ_FIELD(f6, "f6");
+    SOA_OBJ_FIELD(f7, "f7");
+    SOA_OBJ_FIELD(f8, "f8");
+    SOA_OBJ_FIELD(f9, "f9");
+    SOA_OBJ_FIELD(f10, "f10");
+    SOA_OBJ_FIELD(f11, "f11");
+    SOA_OBJ_FIELD(f12, "f12");
+    SOA_OBJ_FIELD(f13, "f13");
+    SOA_OBJ_FIELD(f14, "f14");
+    SOA_OBJ_FIELD(f15, "f15");
+    SOA_OBJ_FIELD(f16, "f16");
+    SOA_OBJ_FIELD(f17, "f17");
+    SOA_OBJ_FIELD(f18, "f18");
+    SOA_OBJ_FIELD(f19, "f19");
+    SOA_OBJ_FIELD(f20, "f20");
+    SOA_OBJ_FIELD(f21, "f21");
+    SOA_OBJ_FIELD(f22, "f22");
+    SOA_OBJ_FIELD(f23, "f23");
+    SOA_OBJ_FIELD(f24, "f24");
+    SOA_OBJ_FIELD(f25, "f25");
+    SOA_OBJ_FIELD(f26, "f26");
+    SOA_OBJ_FIELD(f27, "f27");
+    SOA_OBJ_FIELD(f28, "f28");
+    SOA_OBJ_FIELD(f29, "f29");
+    SOA_OBJ_FIELD(f30, "f30");
+    SOA_OBJ_FIELD(f31, "f31");
+    SOA_OBJ_FIELD(f32, "f32");
+    SOA_OBJ_FIELD(f33, "f33");
+    SOA_OBJ_FIELD(f34, "f34");
+    SOA_OBJ_FIELD(f35, "f35");
+    SOA_OBJ_FIELD(f36, "f36");
+    SOA_OBJ_FIELD(f37, "f37");
+    SOA_OBJ_FIELD(f38, "f38");
+    SOA_OBJ_FIELD(f39, "f39");
+    SOA_OBJ_FIELD(f40, "f40");
+    SOA_OBJ_FIELD(f41, "f41");
+    SOA_OBJ_FIELD(f42, "f42");
+    SOA_OBJ_FIELD(f43, "f43");
+    SOA_OBJ_FIELD(f44, "f44");
+    SOA_OBJ_FIELD(f45, "f45");
+    SOA_OBJ_FIELD(f46, "f46");
+    SOA_OBJ_FIELD(f47, "f47");
+    SOA_OBJ_FIELD(f48, "f48");
+    SOA_OBJ_FIELD(f49, "f49");
+    SOA_OBJ_FIELD(f50, "f50");
+    SOA_OBJ_FIELD(f51, "f51");
+    SOA_OBJ_FIELD(f52, "f52");
+    SOA_OBJ_FIELD(f53, "f53");
+    SOA_OBJ_FIELD(f54, "f54");
+    SOA_OBJ_FIELD(f55, "f55");
+    SOA_OBJ_FIELD(f56, "f56");
+    SOA_OBJ_FIELD(f57, "f57");
+    SOA_OBJ_FIELD(f58, "f58");
+    SOA_OBJ_FIELD(f59, "f59");
+    SOA_OBJ_FIELD(f60, "f60");
+    SOA_OBJ_FIELD(f61, "f61");
+    SOA_OBJ_FIELD(f62, "f62");
+    SOA_OBJ_FIELD(f63, "f63");
+    SOA_OBJ_FIELD(f64, "f64");
+    SOA_OBJ_FIELD(f65, "f65");
+    SOA_OBJ_FIELD(f66, "f66");
+    SOA_OBJ_FIELD(f67, "f67");
+    SOA_OBJ_FIELD(f68, "f68");
+    SOA_OBJ_FIELD(f69, "f69");
+    SOA_SERIALIZE_FILED_END()
+
+    bool operator==(const wide&) const = default;
+};
+
+// Same text a doc parsed from it prints
+bool same_as_doc(const soa::string& json, soa_json_parse_flags_t flags){
+    soa_error_t e;
+    soa_doc_t doc = soa_doc_new_from_json_n(json.data(), json.size(), SOA_JSON_NONE, &e);
+    char* printed = soa_json_new_from_doc(&doc, flags);
+    bool same = !e.code && json == printed;
+    free(printed);
+    soa_doc_free(&doc);
+    return same;
+}
+
+}
+
+int test_serialize(){
+    int failed = 0;
+
+    record r{-42, 0.25, true, "tab\t\"quoted\" \xc3\xa9", {3, 1, 2}, {5, "y"}, "note"};
+    soa::string json;
+    soa::json::to_json(r, json);
+    CHECK(same_as_doc(json, SOA_JSON_NONE));
+    auto back = soa::json::parse_into<record>(json);
+    CHECK(back && *back == r);
+
+    soa::string pretty;
+    soa::json::to_json(r, pretty, soa::json::parse_flag_bits::prettify);
+    CHECK(same_as_doc(pretty, SOA_JSON_PRETTIFY));
+    back = soa::json::parse_into<record>(pretty);
+    CHECK(back && *back == r);
+
+    // array fields land on their positions, the rest is null
+    soa::string arr;
+    soa::json::to_json(spaced{5, "y"}, arr);
+    CHECK(arr == "[null,5,null,\"y\"]");
+    auto s = soa::json::parse_into<spaced>(arr);
+    CHECK(s && s->x == 5 && s->y == "y");
+
+    // keys in any order, unknown ones skipped, optional ones may be missing
+    const char* shuffled = "{\"s\":[null,1,null,\"b\"],\"extra\":{\"deep\":[1,{\"x\":2}]},\"list\":[],"
+        "\"name\":\"n\",\"ok\":false,\"score\":1e3,\"id\":7}";
+    back = soa::json::parse_into<record>(shuffled);
+    CHECK(back && *back == (record{7, 1000, false, "n", {}, {1, "b"}, ""}));
+
+    // too few members fails like reading a doc, enough of them but without
+    // a required one names it
+    const char* short_of = "{\"id\":7,\"score\":1,\"ok\":true,\"name\":\"n\",\"list\":[]}";
+    back = soa::json::parse_into<record>(short_of);
+    CHECK(!back && back.error().code == 1);
+    const char* missing = "{\"id\":7,\"score\":1,\"ok\":true,\"name\":\"n\",\"list\":[],\"extra\":0}";
+    back = soa::json::parse_into<record>(missing);
+    CHECK(!back && back.error().code == 4 && back.error().msg.find("\"s\"") != soa::str::npos);
+
+    static_assert(sizeof(wide) == 70 * sizeof(int));
+    int values[70];
+    for (int i = 0; i < 70; i++) {
+        values[i] = i * 3;
+    }
+    wide w;
+    std::memcpy(&w, values, sizeof(w));
+    soa::string wide_json;
+    soa::json::to_json(w, wide_json);
+    CHECK(same_as_doc(wide_json, SOA_JSON_NONE));
+    auto wide_back = soa::json::parse_into<wide>(wide_json);
+    CHECK(wide_back && *wide_back == w);
+
+    // a required key past the 64th is still reported missing
+    size_t last = wide_json.find(",\"f69\"");
+    CHECK(last != soa::string::npos);
+    wide_json.replace(last, wide_json.size() - 1 - last, ",\"extra\":0");
+    wide_back = soa::json::parse_into<wide>(wide_json);
+    CHECK(!wide_back && wide_back.error().code == 4 && wide_back.error().msg.find("f69") != soa::str::npos);
+
+    return failed;
+}
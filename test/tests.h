@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdio.h>
+
+// Each test returns the number of checks that failed
+#define CHECK(cond) do { \
+    if(!(cond)){ \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        failed++; \
+    } \
+} while(0)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int test_compact(void);
+int test_lookup(void);
+int test_snapshot(void);
+int test_edit(void);
+int test_ndjson(void);
+
+#ifdef __cplusplus
+}
+
+int test_serialize();
+#endif